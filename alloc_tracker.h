@@ -0,0 +1,198 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+#include "memory_accounting.h"
+#include "sharded_counter.h"
+
+// === Учёт выделений памяти ===
+// Включается определением ELECTRIC_DEVICES_ALLOC_TRACKING (опция CMake
+// ELECTRIC_DEVICES_ALLOC_TRACKING). Глобальные operator new/delete
+// заменяются в единственной единице трансляции, где перед подключением
+// этого заголовка определён ALLOC_TRACKER_IMPLEMENT.
+//
+//  - AllocScope считает выделения текущего потока за время своей жизни;
+//  - ALLOC_SITE("имя") помечает участок кода: выделения внутри него
+//    приписываются метке, AllocTracker::Report печатает самые активные.
+// Без ELECTRIC_DEVICES_ALLOC_TRACKING всё это пустые операции
+
+// --- Метка места выделения ---
+struct AllocSite {
+    const char* name;
+    std::atomic<std::uint64_t> count{0};
+    std::atomic<std::uint64_t> bytes{0};
+    AllocSite* next;
+
+    explicit AllocSite(const char* siteName);
+};
+
+class AllocTracker {
+public:
+#ifdef ELECTRIC_DEVICES_ALLOC_TRACKING
+    static constexpr bool kEnabled = true;
+#else
+    static constexpr bool kEnabled = false;
+#endif
+
+private:
+    struct ThreadCounters {
+        std::uint64_t allocations = 0;
+        std::uint64_t bytes = 0;
+        AllocSite* site = nullptr;
+    };
+
+    static ThreadCounters& Counters() {
+        static thread_local ThreadCounters counters;
+        return counters;
+    }
+
+    static std::atomic<AllocSite*>& Head() {
+        static std::atomic<AllocSite*> head{nullptr};
+        return head;
+    }
+
+    // Живые байты пишут все потоки на каждом new/delete: счётчик разбит
+    // по потокам, чтобы они не делили одну кеш-линию
+    static ShardedCounter& Live() {
+        static ShardedCounter live;
+        return live;
+    }
+
+    friend struct AllocSite;
+    friend class AllocSiteGuard;
+
+public:
+    // Вызываются из заменённых operator new/delete; сами ничего не выделяют
+    static void OnAllocate(std::size_t size) {
+        ThreadCounters& counters = Counters();
+        ++counters.allocations;
+        counters.bytes += size;
+        Live().Add(static_cast<std::int64_t>(size));
+        if (counters.site) {
+            counters.site->count.fetch_add(1, std::memory_order_relaxed);
+            counters.site->bytes.fetch_add(size, std::memory_order_relaxed);
+        }
+    }
+
+    static void OnFree(std::size_t size) {
+        Live().Add(-static_cast<std::int64_t>(size));
+    }
+
+    static std::uint64_t ThreadAllocations() { return Counters().allocations; }
+    static std::uint64_t ThreadBytes() { return Counters().bytes; }
+    static std::int64_t LiveBytes() { return Live().Value(); }
+
+    // Печатает top меток с наибольшим числом выделений
+    static void Report(std::FILE* out, std::size_t top = 10) {
+        if (!kEnabled) {
+            std::fprintf(out, "allocation tracking is disabled\n");
+            return;
+        }
+        AllocSite* sites[64];
+        std::size_t count = 0;
+        for (AllocSite* site = Head().load(); site && count < 64; site = site->next) sites[count++] = site;
+        std::sort(sites, sites + count, [](const AllocSite* a, const AllocSite* b) { return a->count > b->count; });
+        std::fprintf(out, "%-32s %14s %16s\n", "allocation site", "allocations", "bytes");
+        for (std::size_t i = 0; i < count && i < top; ++i) {
+            std::fprintf(out, "%-32s %14llu %16llu\n", sites[i]->name,
+                         static_cast<unsigned long long>(sites[i]->count.load()),
+                         static_cast<unsigned long long>(sites[i]->bytes.load()));
+        }
+    }
+};
+
+inline AllocSite::AllocSite(const char* siteName) : name(siteName), next(AllocTracker::Head().load()) {
+    while (!AllocTracker::Head().compare_exchange_weak(next, this)) {
+    }
+}
+
+// --- Текущая метка потока на время жизни объекта ---
+class AllocSiteGuard {
+private:
+    AllocSite* _previous;
+
+public:
+    explicit AllocSiteGuard(AllocSite* site) : _previous(AllocTracker::Counters().site) {
+        AllocTracker::Counters().site = site;
+    }
+    ~AllocSiteGuard() { AllocTracker::Counters().site = _previous; }
+
+    AllocSiteGuard(const AllocSiteGuard&) = delete;
+    AllocSiteGuard& operator=(const AllocSiteGuard&) = delete;
+};
+
+// --- Счётчик выделений текущего потока в пределах области ---
+class AllocScope {
+private:
+    std::uint64_t _allocations;
+    std::uint64_t _bytes;
+
+public:
+    AllocScope() : _allocations(AllocTracker::ThreadAllocations()), _bytes(AllocTracker::ThreadBytes()) {}
+
+    std::uint64_t Allocations() const { return AllocTracker::ThreadAllocations() - _allocations; }
+    std::uint64_t Bytes() const { return AllocTracker::ThreadBytes() - _bytes; }
+};
+
+#define ALLOC_SITE_CONCAT_INNER(a, b) a##b
+#define ALLOC_SITE_CONCAT(a, b) ALLOC_SITE_CONCAT_INNER(a, b)
+
+#ifdef ELECTRIC_DEVICES_ALLOC_TRACKING
+#define ALLOC_SITE(siteName)                                                    \
+    static AllocSite ALLOC_SITE_CONCAT(allocSite_, __LINE__){siteName};         \
+    AllocSiteGuard ALLOC_SITE_CONCAT(allocSiteGuard_, __LINE__)(&ALLOC_SITE_CONCAT(allocSite_, __LINE__))
+#else
+#define ALLOC_SITE(siteName) ((void)0)
+#endif
+
+// --- Замена глобальных operator new/delete ---
+// Перед блоком хранятся его размер и подсистема (см. memory_accounting.h),
+// чтобы delete вычитал байты оттуда же, куда их записал new. Подмена нужна
+// и учёту выделений, и учёту памяти по подсистемам
+#if defined(ALLOC_TRACKER_IMPLEMENT) && \
+    (defined(ELECTRIC_DEVICES_ALLOC_TRACKING) || defined(ELECTRIC_DEVICES_MEMORY_ACCOUNTING))
+namespace alloc_tracker_detail {
+constexpr std::size_t kHeader = alignof(std::max_align_t);
+struct Header {
+    std::size_t size;
+    MemoryTag tag;
+};
+static_assert(sizeof(Header) <= kHeader, "allocation header too small");
+}  // namespace alloc_tracker_detail
+
+void* operator new(std::size_t size) {
+    void* block = std::malloc(size + alloc_tracker_detail::kHeader);
+    if (!block) throw std::bad_alloc();
+    auto* header = static_cast<alloc_tracker_detail::Header*>(block);
+    header->size = size;
+    header->tag = MemoryAccounting::CurrentTag();
+    MemoryAccounting::OnAllocate(header->tag, size);
+#ifdef ELECTRIC_DEVICES_ALLOC_TRACKING
+    AllocTracker::OnAllocate(size);
+#endif
+    return static_cast<char*>(block) + alloc_tracker_detail::kHeader;
+}
+
+void* operator new[](std::size_t size) { return operator new(size); }
+
+void operator delete(void* ptr) noexcept {
+    if (!ptr) return;
+    void* block = static_cast<char*>(ptr) - alloc_tracker_detail::kHeader;
+    const auto* header = static_cast<const alloc_tracker_detail::Header*>(block);
+    MemoryAccounting::OnFree(header->tag, header->size);
+#ifdef ELECTRIC_DEVICES_ALLOC_TRACKING
+    AllocTracker::OnFree(header->size);
+#endif
+    std::free(block);
+}
+
+void operator delete[](void* ptr) noexcept { operator delete(ptr); }
+void operator delete(void* ptr, std::size_t) noexcept { operator delete(ptr); }
+void operator delete[](void* ptr, std::size_t) noexcept { operator delete(ptr); }
+#endif
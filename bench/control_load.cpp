@@ -0,0 +1,230 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#include "../control_protocol.h"
+
+// === Нагрузочный клиент сервиса управления ===
+// control_load <порт> [соединений] [глубина конвейера] [секунд] [устройств]
+// Каждое соединение в своём потоке шлёт пачку из «глубины» запросов
+// (90% On/Off по случайным дескрипторам, 5% Query, 5% Total), читает
+// столько же ответов и повторяет. Если на сервере меньше устройств, чем
+// задано, клиент сначала добавляет недостающие. Печатает операций в
+// секунду и задержку пачки; при ошибочных ответах завершается с ненулевым кодом
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+namespace cp = control_protocol;
+
+#ifndef _WIN32
+int Connect(std::uint16_t port) {
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        ::close(fd);
+        return -1;
+    }
+    int one = 1;
+    ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    return fd;
+}
+
+bool SendAll(int fd, const std::string& data) {
+    std::size_t sent = 0;
+    while (sent < data.size()) {
+        ssize_t written = ::send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (written <= 0) return false;
+        sent += static_cast<std::size_t>(written);
+    }
+    return true;
+}
+
+// Читает count ответов; в statuses — их статусы, в last — тело последнего
+bool ReadResponses(int fd, std::string& buffer, std::size_t count, std::vector<std::uint8_t>& statuses,
+                   std::string& last) {
+    statuses.clear();
+    std::size_t offset = 0;
+    char chunk[65536];
+    while (statuses.size() < count) {
+        std::size_t frame = cp::CompleteFrame(buffer.data() + offset, buffer.size() - offset);
+        if (frame == static_cast<std::size_t>(-1)) return false;
+        if (frame == 0) {
+            buffer.erase(0, offset);
+            offset = 0;
+            ssize_t read = ::recv(fd, chunk, sizeof(chunk), 0);
+            if (read <= 0) return false;
+            buffer.append(chunk, static_cast<std::size_t>(read));
+            continue;
+        }
+        statuses.push_back(static_cast<std::uint8_t>(buffer[offset + cp::kLengthBytes]));
+        last.assign(buffer, offset + cp::kLengthBytes + 1, frame - cp::kLengthBytes - 1);
+        offset += frame;
+    }
+    buffer.erase(0, offset);
+    return true;
+}
+
+// Один запрос и ответ на отдельном соединении: число устройств на сервере
+bool QueryDeviceCount(std::uint16_t port, std::uint64_t& devices) {
+    int fd = Connect(port);
+    if (fd < 0) return false;
+    std::string request, buffer, body;
+    std::vector<std::uint8_t> statuses;
+    cp::AppendTotal(request);
+    bool ok = SendAll(fd, request) && ReadResponses(fd, buffer, 1, statuses, body) &&
+              statuses[0] == static_cast<std::uint8_t>(cp::Status::Ok) && body.size() == 24;
+    if (ok) devices = cp::GetU64(body.data() + 8);
+    ::close(fd);
+    return ok;
+}
+
+bool AddDevices(std::uint16_t port, std::uint64_t count) {
+    int fd = Connect(port);
+    if (fd < 0) return false;
+    std::string request, buffer, body;
+    std::vector<std::uint8_t> statuses;
+    for (std::uint64_t added = 0; added < count; added += cp::kMaxAddCount) {
+        std::uint64_t chunk = std::min<std::uint64_t>(count - added, cp::kMaxAddCount);
+        cp::AppendAdd(request, cp::DeviceType::Fridge, static_cast<std::uint32_t>(chunk));
+    }
+    std::size_t requests = static_cast<std::size_t>((count + cp::kMaxAddCount - 1) / cp::kMaxAddCount);
+    bool ok = SendAll(fd, request) && ReadResponses(fd, buffer, requests, statuses, body);
+    for (std::uint8_t status : statuses) ok = ok && status == static_cast<std::uint8_t>(cp::Status::Ok);
+    ::close(fd);
+    return ok;
+}
+#endif
+
+struct WorkerResult {
+    std::uint64_t operations = 0;
+    std::uint64_t errors = 0;
+    std::vector<double> roundTripsUs;
+};
+
+}  // namespace
+
+int main(int argc, char** argv) {
+#ifdef _WIN32
+    (void)argc;
+    (void)argv;
+    std::fprintf(stderr, "control_load is not supported on Windows\n");
+    return 1;
+#else
+    if (argc < 2) {
+        std::fprintf(stderr, "usage: control_load <port> [connections] [depth] [seconds] [devices]\n");
+        return 1;
+    }
+    std::uint16_t port = static_cast<std::uint16_t>(std::atoi(argv[1]));
+    unsigned connections = argc > 2 ? static_cast<unsigned>(std::atoi(argv[2])) : 4;
+    std::size_t depth = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 128;
+    double seconds = argc > 4 ? std::atof(argv[4]) : 3.0;
+    std::uint64_t wanted = argc > 5 ? std::strtoull(argv[5], nullptr, 10) : 10000;
+    if (connections == 0 || depth == 0) {
+        std::fprintf(stderr, "connections and depth must be positive\n");
+        return 1;
+    }
+
+    std::uint64_t devices = 0;
+    if (!QueryDeviceCount(port, devices)) {
+        std::fprintf(stderr, "cannot reach control server on 127.0.0.1:%u\n", static_cast<unsigned>(port));
+        return 1;
+    }
+    if (devices < wanted) {
+        if (!AddDevices(port, wanted - devices) || !QueryDeviceCount(port, devices)) {
+            std::fprintf(stderr, "cannot add devices\n");
+            return 1;
+        }
+    }
+    if (devices == 0) {
+        std::fprintf(stderr, "server has no devices\n");
+        return 1;
+    }
+
+    std::vector<WorkerResult> results(connections);
+    std::atomic<bool> failed{false};
+    std::vector<std::thread> workers;
+    auto deadline = Clock::now() + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(seconds));
+    auto start = Clock::now();
+    for (unsigned c = 0; c < connections; ++c) {
+        workers.emplace_back([&, c] {
+            WorkerResult& result = results[c];
+            int fd = Connect(port);
+            if (fd < 0) {
+                failed = true;
+                return;
+            }
+            std::mt19937_64 random(c + 1);
+            std::string request, buffer, body;
+            std::vector<std::uint8_t> statuses;
+            while (Clock::now() < deadline) {
+                request.clear();
+                for (std::size_t i = 0; i < depth; ++i) {
+                    std::uint64_t r = random();
+                    std::uint32_t handle = static_cast<std::uint32_t>((r >> 8) % devices);
+                    unsigned kind = static_cast<unsigned>(r % 20);
+                    if (kind < 9) cp::AppendHandleOp(request, cp::Op::On, handle);
+                    else if (kind < 18) cp::AppendHandleOp(request, cp::Op::Off, handle);
+                    else if (kind < 19) cp::AppendHandleOp(request, cp::Op::Query, handle);
+                    else cp::AppendTotal(request);
+                }
+                auto sentAt = Clock::now();
+                if (!SendAll(fd, request) || !ReadResponses(fd, buffer, depth, statuses, body)) {
+                    failed = true;
+                    break;
+                }
+                result.roundTripsUs.push_back(std::chrono::duration<double, std::micro>(Clock::now() - sentAt).count());
+                result.operations += depth;
+                for (std::uint8_t status : statuses) result.errors += status != static_cast<std::uint8_t>(cp::Status::Ok);
+            }
+            ::close(fd);
+        });
+    }
+    for (std::thread& worker : workers) worker.join();
+    double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+    std::uint64_t operations = 0, errors = 0;
+    std::vector<double> roundTrips;
+    for (const WorkerResult& result : results) {
+        operations += result.operations;
+        errors += result.errors;
+        roundTrips.insert(roundTrips.end(), result.roundTripsUs.begin(), result.roundTripsUs.end());
+    }
+    std::sort(roundTrips.begin(), roundTrips.end());
+    auto percentile = [&roundTrips](double q) {
+        return roundTrips.empty() ? 0.0 : roundTrips[static_cast<std::size_t>(q * (roundTrips.size() - 1))];
+    };
+    std::printf("devices %llu, connections %u, depth %zu\n", static_cast<unsigned long long>(devices), connections,
+                depth);
+    std::printf("operations %llu in %.2f s: %.0f ops/s\n", static_cast<unsigned long long>(operations), elapsed,
+                operations / elapsed);
+    std::printf("batch round trip, us: p50 %.1f, p99 %.1f, max %.1f\n", percentile(0.5), percentile(0.99),
+                roundTrips.empty() ? 0.0 : roundTrips.back());
+    if (errors || failed) {
+        std::fprintf(stderr, "errors: %llu bad responses%s\n", static_cast<unsigned long long>(errors),
+                     failed ? ", connection failure" : "");
+        return 1;
+    }
+    return 0;
+#endif
+}
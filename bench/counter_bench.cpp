@@ -0,0 +1,92 @@
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "../sharded_counter.h"
+
+// === Бенчмарк счётчиков под нагрузкой из нескольких потоков ===
+// Для 1, 2, 4, ... --threads потоков каждый поток --ops раз увеличивает:
+//  - atomic  — один общий std::atomic (fetch_add), все потоки в одной линии;
+//  - packed  — свой std::atomic на поток, но соседние в одной кеш-линии
+//              (ложное разделение);
+//  - sharded — ShardedCounter: своя выровненная ячейка, без RMW.
+// Печатается нс на операцию и суммарная пропускная способность.
+// Масштабирование видно только при числе ядер не меньше числа потоков
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Запускает threads потоков, каждый вызывает body(номер потока);
+// возвращает время от общего старта до завершения последнего
+template <typename Fn>
+double RunThreads(unsigned threads, Fn&& body) {
+    std::atomic<unsigned> ready{0};
+    std::atomic<bool> go{false};
+    std::vector<std::thread> workers;
+    for (unsigned t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t] {
+            ready.fetch_add(1);
+            while (!go.load(std::memory_order_acquire)) std::this_thread::yield();
+            body(t);
+        });
+    }
+    while (ready.load() != threads) std::this_thread::yield();
+    auto start = Clock::now();
+    go.store(true, std::memory_order_release);
+    for (std::thread& worker : workers) worker.join();
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+void Report(const char* name, unsigned threads, std::uint64_t ops, double seconds, std::int64_t value) {
+    double total = static_cast<double>(ops) * threads;
+    std::printf("%-8s %8u %12.2f %14.1f%s\n", name, threads, seconds * 1e9 * threads / total, total / seconds / 1e6,
+                value == static_cast<std::int64_t>(total) ? "" : "  (неверная сумма)");
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    unsigned maxThreads = std::thread::hardware_concurrency() ? std::thread::hardware_concurrency() : 1;
+    std::uint64_t ops = 10000000;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            maxThreads = static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (std::strcmp(argv[i], "--ops") == 0 && i + 1 < argc) {
+            ops = static_cast<std::uint64_t>(std::strtod(argv[++i], nullptr));
+        } else {
+            std::fprintf(stderr, "usage: counter_bench [--threads N] [--ops N]\n");
+            return 1;
+        }
+    }
+    if (maxThreads == 0) maxThreads = 1;
+
+    std::printf("%-8s %8s %12s %14s\n", "counter", "threads", "ns/op", "Mops/s total");
+    for (unsigned threads = 1; threads <= maxThreads; threads *= 2) {
+        std::atomic<std::int64_t> shared{0};
+        double seconds = RunThreads(threads, [&](unsigned) {
+            for (std::uint64_t i = 0; i < ops; ++i) shared.fetch_add(1, std::memory_order_relaxed);
+        });
+        Report("atomic", threads, ops, seconds, shared.load());
+
+        std::vector<std::atomic<std::int64_t>> packed(threads);
+        seconds = RunThreads(threads, [&](unsigned t) {
+            for (std::uint64_t i = 0; i < ops; ++i) packed[t].fetch_add(1, std::memory_order_relaxed);
+        });
+        std::int64_t sum = 0;
+        for (const auto& cell : packed) sum += cell.load();
+        Report("packed", threads, ops, seconds, sum);
+
+        ShardedCounter sharded;
+        seconds = RunThreads(threads, [&](unsigned) {
+            for (std::uint64_t i = 0; i < ops; ++i) sharded.Increment();
+        });
+        Report("sharded", threads, ops, seconds, sharded.Value());
+    }
+    return 0;
+}
@@ -0,0 +1,287 @@
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#define dup _dup
+#define dup2 _dup2
+#define open _open
+#define close _close
+static const char* kNullDevice = "NUL";
+#else
+#include <fcntl.h>
+#include <unistd.h>
+static const char* kNullDevice = "/dev/null";
+#endif
+
+// Выделения считает alloc_tracker.h; сборка задаёт ELECTRIC_DEVICES_ALLOC_TRACKING
+#define ALLOC_TRACKER_IMPLEMENT
+#include "../alloc_tracker.h"
+#include "../console_ui.h"
+#include "../device_manager.h"
+#include "../devices.h"
+#include "../logger.h"
+
+// === Бенчмарк масштабирования DeviceManager ===
+// Для парков от 1e3 до --max устройств (по умолчанию 1e6, допустимо до 1e8)
+// измеряет AddDevice, TurnOnAll, GetTotalPower, обход GetDevices и
+// ConsoleUI::ShowDevices (и для сравнения прежний вывод std::cout по строке
+// на устройство): нс/операцию, выделения памяти на операцию, байт на
+// устройство, МБ/с вывода и показатель роста времени между соседними
+// размерами. Таблица печатается в stdout, с --json <файл|-> — ещё и JSON;
+// при --json - в stdout идёт только JSON, а таблица и отчёты — в stderr.
+// Затем проверяется установившийся режим: переключения, подсчёт мощности
+// и логирование на отключённом уровне не должны выделять память вовсе;
+// при нарушении бенчмарк завершается с ненулевым кодом
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Result {
+    std::string op;
+    std::size_t devices;
+    double nsPerOp;
+    double allocationsPerOp;
+    double bytesPerDevice;  // только для AddDevice, иначе 0
+    double megabytesPerSecond;  // только для ShowDevices, иначе 0
+};
+
+struct Sample {
+    double seconds;
+    std::uint64_t allocations;
+};
+
+template <typename Fn>
+Sample Measure(Fn&& fn) {
+    AllocScope scope;
+    auto start = Clock::now();
+    fn();
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    return Sample{seconds, scope.Allocations()};
+}
+
+void Record(std::vector<Result>& results, const char* op, std::size_t devices, std::size_t ops,
+            const Sample& sample, double bytesPerDevice = 0, double megabytesPerSecond = 0) {
+    results.push_back(Result{op, devices, sample.seconds * 1e9 / static_cast<double>(ops),
+                             static_cast<double>(sample.allocations) / static_cast<double>(ops),
+                             bytesPerDevice, megabytesPerSecond});
+}
+
+// Прежний способ вывода списка: std::cout << GetInfo() по строке на устройство
+void ShowDevicesPerLine(const DeviceManager& manager) {
+    std::cout << "\nСписок устройств:\n";
+    for (const auto& device : manager.GetDevices()) {
+        std::cout << device->GetInfo() << "\n";
+    }
+    std::cout.flush();
+}
+
+void RunSize(std::size_t count, int nullFd, std::vector<Result>& results) {
+    auto* manager = new DeviceManager(LoggerFactory::CreateLogger(LoggerFactory::None));
+    RefrigeratorFactory fridgeFactory;
+    DrillFactory drillFactory;
+
+    std::int64_t liveBefore = AllocTracker::LiveBytes();
+    Sample add = Measure([&] {
+        for (std::size_t i = 0; i < count; ++i) {
+            manager->AddDevice(i % 2 ? drillFactory.Create() : fridgeFactory.Create());
+        }
+    });
+    double bytesPerDevice = static_cast<double>(AllocTracker::LiveBytes() - liveBefore) / static_cast<double>(count);
+    Record(results, "AddDevice", count, count, add, bytesPerDevice);
+
+    Record(results, "TurnOnAll", count, count, Measure([&] { manager->TurnOnAll(); }));
+
+    const std::size_t totalCalls = 1000000;
+    volatile long long sink = 0;
+    Record(results, "GetTotalPower", count, totalCalls, Measure([&] {
+        for (std::size_t i = 0; i < totalCalls; ++i) sink = sink + manager->GetTotalPower();
+    }));
+
+    Record(results, "GetDevices iteration", count, count, Measure([&] {
+        long long total = 0;
+        for (const auto& device : manager->GetDevices()) total += device->GetPower();
+        sink = total;
+    }));
+
+    std::string probe;
+    ConsoleUI(*manager, nullptr).RenderDevices(probe, false);
+    double megabytes = static_cast<double>(probe.size()) / 1e6;
+    probe = std::string();
+    ConsoleUI ui(*manager, nullptr, nullFd);
+    Sample show = Measure([&] { ui.ShowDevices(); });
+    Record(results, "ShowDevices", count, count, show, 0, megabytes / show.seconds);
+
+    // std::cout пишет в дескриптор 1: на время замера он указывает на nullFd
+    std::fflush(stdout);
+    int savedStdout = dup(1);
+    dup2(nullFd, 1);
+    Sample perLine = Measure([&] { ShowDevicesPerLine(*manager); });
+    dup2(savedStdout, 1);
+    close(savedStdout);
+    Record(results, "ShowDevices per line", count, count, perLine, 0, megabytes / perLine.seconds);
+
+    delete manager;
+}
+
+// --- Установившийся режим без выделений памяти ---
+bool ExpectNoAllocations(std::FILE* out, const char* what, std::uint64_t allocations) {
+    std::fprintf(out, "%-44s %10llu  %s\n", what, static_cast<unsigned long long>(allocations),
+                allocations == 0 ? "ok" : "FAIL");
+    return allocations == 0;
+}
+
+bool CheckSteadyState(std::FILE* out) {
+    const std::size_t devices = 10000;
+    const int cycles = 100;
+    // Консольный логгер с порогом Error: сообщения Info отбрасываются ещё до сборки строки
+    auto logger = LoggerFactory::CreateLogger(LoggerFactory::Console);
+    logger->SetLevel(LogLevel::Error);
+    DeviceManager manager(logger);
+    RefrigeratorFactory fridgeFactory;
+    DrillFactory drillFactory;
+    manager.AddDevices(fridgeFactory, devices / 2);
+    manager.AddDevices(drillFactory, devices / 2);
+
+    // Прогрев: все ленивые структуры строятся здесь
+    manager.TurnOnAll();
+    manager.TurnOffAll();
+
+    std::fprintf(out, "\nsteady state (%zu devices, %d cycles)\n", devices, cycles);
+    std::fprintf(out, "%-44s %10s\n", "check", "allocs");
+    bool ok = true;
+    {
+        AllocScope scope;
+        for (int i = 0; i < cycles; ++i) {
+            manager.TurnOnAll();
+            manager.TurnOffAll();
+        }
+        ok &= ExpectNoAllocations(out, "TurnOnAll/TurnOffAll", scope.Allocations());
+    }
+    {
+        AllocScope scope;
+        for (int i = 0; i < cycles; ++i) {
+            for (DeviceHandle handle = 0; handle < devices; handle += 7) {
+                manager.TurnOn(handle);
+                manager.TurnOff(handle);
+            }
+        }
+        ok &= ExpectNoAllocations(out, "TurnOn/TurnOff by handle", scope.Allocations());
+    }
+    {
+        volatile long long sink = 0;
+        AllocScope scope;
+        for (int i = 0; i < cycles * 1000; ++i) sink = sink + manager.GetTotalPower();
+        ok &= ExpectNoAllocations(out, "GetTotalPower", scope.Allocations());
+    }
+    {
+        ConsoleUI ui(manager, logger);
+        std::streambuf* saved = std::cout.rdbuf(nullptr);
+        AllocScope scope;
+        for (int i = 0; i < cycles; ++i) ui.ShowTotalPower();
+        std::uint64_t allocations = scope.Allocations();
+        std::cout.rdbuf(saved);
+        std::cout.clear();
+        ok &= ExpectNoAllocations(out, "ShowTotalPower log at disabled level", allocations);
+    }
+
+    // Для наглядности — где память выделяется при включённом логировании
+    auto batch = std::make_shared<BatchLogger>(LoggerFactory::CreateLogger(LoggerFactory::None));
+    DeviceManager logged(batch);
+    logged.AddDevices(fridgeFactory, 100);
+    logged.TurnOnAll();
+    logged.TurnOffAll();
+    batch->Commit("bench");
+    std::fprintf(out, "\ntop allocation sites\n");
+    std::fflush(out);
+    AllocTracker::Report(out, 5);
+    return ok;
+}
+
+void PrintTable(const std::vector<Result>& results, std::FILE* out) {
+    std::fprintf(out, "%-22s %12s %12s %12s %12s %10s %8s\n", "operation", "devices", "ns/op", "allocs/op",
+                "bytes/dev", "MB/s", "growth");
+    for (std::size_t i = 0; i < results.size(); ++i) {
+        const Result& r = results[i];
+        // Показатель роста: 1.0 — линейно по числу устройств, 0 — не зависит от размера
+        std::string growth = "-";
+        for (std::size_t j = i; j-- > 0;) {
+            if (results[j].op != r.op) continue;
+            double total = r.nsPerOp * static_cast<double>(r.devices);
+            double previous = results[j].nsPerOp * static_cast<double>(results[j].devices);
+            if (r.op == "GetTotalPower") total = r.nsPerOp, previous = results[j].nsPerOp;
+            char buffer[32];
+            std::snprintf(buffer, sizeof(buffer), "%.2f",
+                          std::log(total / previous) / std::log(double(r.devices) / double(results[j].devices)));
+            growth = buffer;
+            break;
+        }
+        std::fprintf(out, "%-22s %12zu %12.2f %12.3f %12.1f %10.1f %8s\n", r.op.c_str(), r.devices, r.nsPerOp,
+                    r.allocationsPerOp, r.bytesPerDevice, r.megabytesPerSecond, growth.c_str());
+    }
+}
+
+void WriteJson(const std::vector<Result>& results, std::FILE* out) {
+    std::fprintf(out, "{\n  \"benchmark\": \"device_bench\",\n  \"results\": [\n");
+    for (std::size_t i = 0; i < results.size(); ++i) {
+        const Result& r = results[i];
+        std::fprintf(out,
+                     "    {\"op\": \"%s\", \"devices\": %zu, \"ns_per_op\": %.3f, \"allocs_per_op\": %.4f, "
+                     "\"bytes_per_device\": %.2f, \"mb_per_s\": %.2f}%s\n",
+                     r.op.c_str(), r.devices, r.nsPerOp, r.allocationsPerOp, r.bytesPerDevice,
+                     r.megabytesPerSecond, i + 1 < results.size() ? "," : "");
+    }
+    std::fprintf(out, "  ]\n}\n");
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    std::size_t maxDevices = 1000000;
+    const char* jsonPath = nullptr;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--max") == 0 && i + 1 < argc) {
+            maxDevices = static_cast<std::size_t>(std::strtod(argv[++i], nullptr));
+        } else if (std::strcmp(argv[i], "--json") == 0 && i + 1 < argc) {
+            jsonPath = argv[++i];
+        } else {
+            std::fprintf(stderr, "usage: device_bench [--max N] [--json file|-]\n");
+            return 1;
+        }
+    }
+
+    int nullFd = open(kNullDevice, O_WRONLY);
+    std::vector<Result> results;
+    for (std::size_t count = 1000; count <= maxDevices && count <= 100000000; count *= 10) {
+        RunSize(count, nullFd, results);
+    }
+    close(nullFd);
+
+    // JSON в stdout должен разбираться целиком: остальное уходит в stderr
+    bool jsonToStdout = jsonPath && std::strcmp(jsonPath, "-") == 0;
+    std::FILE* report = jsonToStdout ? stderr : stdout;
+    PrintTable(results, report);
+    if (jsonPath) {
+        std::FILE* out = jsonToStdout ? stdout : std::fopen(jsonPath, "w");
+        if (!out) {
+            std::fprintf(stderr, "cannot open %s\n", jsonPath);
+            return 1;
+        }
+        WriteJson(results, out);
+        if (!jsonToStdout) std::fclose(out);
+    }
+
+    if (!CheckSteadyState(report)) {
+        std::fprintf(stderr, "steady-state allocation check failed\n");
+        return 1;
+    }
+    return 0;
+}
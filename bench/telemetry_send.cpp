@@ -0,0 +1,104 @@
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#ifndef _WIN32
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#include "../telemetry.h"
+
+// === Имитатор устройств для приёма телеметрии ===
+// telemetry_send <UDP-порт|путь Unix-сокета> [устройств] [секунд] [записей в датаграмме]
+// Обходит дескрипторы 0..устройств-1 по кругу, для каждого шлёт
+// случайную мощность 0..2000 Вт. Датаграммы уходят пачками по 64 через
+// sendmmsg, без ограничения темпа. Печатает число отправленных показаний
+// и темп; сверить с принятым можно по выводу ElectricDevices --ingest
+
+int main(int argc, char** argv) {
+#ifdef _WIN32
+    (void)argc;
+    (void)argv;
+    std::fprintf(stderr, "telemetry_send is not supported on Windows\n");
+    return 1;
+#else
+    if (argc < 2) {
+        std::fprintf(stderr, "usage: telemetry_send <port|unix path> [devices] [seconds] [records per datagram]\n");
+        return 1;
+    }
+    const char* endpoint = argv[1];
+    std::uint32_t devices = argc > 2 ? static_cast<std::uint32_t>(std::strtoul(argv[2], nullptr, 10)) : 10000;
+    double seconds = argc > 3 ? std::atof(argv[3]) : 3.0;
+    std::size_t records = argc > 4 ? std::strtoull(argv[4], nullptr, 10) : telemetry_wire::kMaxRecords;
+    if (devices == 0 || records == 0 || records > telemetry_wire::kMaxRecords) {
+        std::fprintf(stderr, "devices must be positive, records per datagram 1..%zu\n", telemetry_wire::kMaxRecords);
+        return 1;
+    }
+
+    bool udp = std::strspn(endpoint, "0123456789") == std::strlen(endpoint);
+    int fd = ::socket(udp ? AF_INET : AF_UNIX, SOCK_DGRAM, 0);
+    int connected = -1;
+    if (fd >= 0 && udp) {
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(static_cast<std::uint16_t>(std::atoi(endpoint)));
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        connected = ::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address));
+    } else if (fd >= 0) {
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        std::strncpy(address.sun_path, endpoint, sizeof(address.sun_path) - 1);
+        connected = ::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address));
+    }
+    if (connected != 0) {
+        std::perror("connect");
+        return 1;
+    }
+
+    constexpr std::size_t kBatch = 64;
+    std::vector<unsigned char> payload(kBatch * records * telemetry_wire::kRecordBytes);
+    mmsghdr messages[kBatch];
+    iovec vectors[kBatch];
+    for (std::size_t i = 0; i < kBatch; ++i) {
+        vectors[i] = {&payload[i * records * telemetry_wire::kRecordBytes], records * telemetry_wire::kRecordBytes};
+        messages[i] = {};
+        messages[i].msg_hdr.msg_iov = &vectors[i];
+        messages[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    std::mt19937 random(1);
+    std::uint32_t next = 0;
+    std::uint64_t sent = 0;
+    auto start = std::chrono::steady_clock::now();
+    auto deadline = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                                std::chrono::duration<double>(seconds));
+    while (std::chrono::steady_clock::now() < deadline) {
+        for (std::size_t r = 0; r < kBatch * records; ++r) {
+            PowerReading reading{next, static_cast<std::int32_t>(random() % 2001)};
+            telemetry_wire::Encode(reading, &payload[r * telemetry_wire::kRecordBytes]);
+            if (++next == devices) next = 0;
+        }
+        int count = ::sendmmsg(fd, messages, kBatch, 0);
+        if (count < 0) {
+            // Переполненный буфер сокета: приём не успевает, пробуем дальше
+            if (errno == ENOBUFS || errno == EAGAIN) continue;
+            std::perror("sendmmsg");
+            return 1;
+        }
+        sent += static_cast<std::uint64_t>(count) * records;
+    }
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::printf("sent %llu readings in %.2f s: %.0f readings/s\n", static_cast<unsigned long long>(sent), elapsed,
+                sent / elapsed);
+    ::close(fd);
+    return 0;
+#endif
+}
@@ -0,0 +1,530 @@
+#pragma once
+
+#include <charconv>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "console_ui.h"
+#include "control_protocol.h"
+#include "device_manager.h"
+#include "devices.h"
+#include "filter_expression.h"
+#include "fleet_generator.h"
+
+// === Безынтерфейсный обработчик команд ===
+// Читает команды построчно из потока большими блоками:
+//   add <fridge|drill> [количество]
+//   generate <количество> [seed] [доля включённых]
+//   load <файл снимка>
+//   on <дескриптор|all|имя>
+//   off <дескриптор|all|имя>
+//   total
+//   list [курсор] [размер страницы]
+//   search <prefix|sub|fuzzy> <текст>
+//   tag|untag <метка> <дескриптор|all|имя>
+//   sorted <power|load|name> [asc|desc] [позиция]
+//   top [N]
+//   filter <выражение> [-> on|off|list [курсор]]
+//   select <метка> [and|or|andnot <метка>]... [-> on|off]
+//   find [type=<тип>] [name=<подстрока>] [on=<0|1>] [min=<Вт>] [from=<курсор>] [limit=<N>]
+//   demand [window <секунд>]
+//   sketches [N]
+// Строки разбираются без копирования (string_view поверх буфера чтения),
+// подряд идущие on/off применяются к менеджеру одним пакетом, а ответы
+// копятся в буфере и выводятся одним write на блок входных данных
+class CommandProcessor {
+private:
+    static constexpr std::size_t kReadBytes = 1 << 20;
+    static constexpr std::size_t kDefaultPageSize = 20;
+    // Больше за одну команду не выводится: страница целиком копится в _out
+    static constexpr std::size_t kMaxPageSize = 100000;
+    // Окно нагрузки не длиннее трёх суток: и перевод в миллисекунды, и
+    // площадь окна (Вт·мс) остаются в пределах 64 бит
+    static constexpr std::size_t kMaxDemandWindowSeconds = 3 * 24 * 60 * 60;
+
+    enum class PendingOp { None, On, Off };
+
+    DeviceManager& _manager;
+    ConsoleUI _ui;
+    int _outFd;
+    RefrigeratorFactory _fridgeFactory;
+    DrillFactory _drillFactory;
+
+    PendingOp _pendingOp = PendingOp::None;
+    std::vector<DeviceHandle> _pending;
+    std::string _out;
+    std::size_t _lineNumber = 0;
+    std::size_t _executed = 0;
+    bool _quitRequested = false;
+    std::string _typeFilter;
+    std::vector<DeviceHandle> _targets;
+    FilterExpression _filter;
+
+    // Следующее слово строки; line сдвигается за него
+    static std::string_view NextToken(std::string_view& line) {
+        std::size_t begin = 0;
+        while (begin < line.size() && (line[begin] == ' ' || line[begin] == '\t')) ++begin;
+        std::size_t end = begin;
+        while (end < line.size() && line[end] != ' ' && line[end] != '\t') ++end;
+        std::string_view token = line.substr(begin, end - begin);
+        line.remove_prefix(end);
+        return token;
+    }
+
+    static bool ParseNumber(std::string_view token, std::size_t& value) {
+        if (token.empty()) return false;
+        auto res = std::from_chars(token.data(), token.data() + token.size(), value);
+        return res.ec == std::errc() && res.ptr == token.data() + token.size();
+    }
+
+    const DeviceFactory* FindFactory(std::string_view type) const {
+        if (type == "fridge" || type == "refrigerator") return &_fridgeFactory;
+        if (type == "drill") return &_drillFactory;
+        return nullptr;
+    }
+
+    void AppendAdded(DeviceHandle first, std::size_t count) {
+        _out += "added ";
+        AppendInt(_out, static_cast<long long>(first));
+        _out += ' ';
+        AppendInt(_out, static_cast<long long>(count));
+        _out += '\n';
+    }
+
+    void Error(const char* message) {
+        _out += "error: line ";
+        AppendInt(_out, static_cast<long long>(_lineNumber));
+        _out += ": ";
+        _out += message;
+        _out += '\n';
+    }
+
+    void FlushPending() {
+        if (_pendingOp == PendingOp::On) _manager.TurnOn(_pending);
+        if (_pendingOp == PendingOp::Off) _manager.TurnOff(_pending);
+        _pending.clear();
+        _pendingOp = PendingOp::None;
+    }
+
+    // Дескрипторы по аргументу команды: номер, all или имя устройства
+    bool ResolveTargets(std::string_view arg, std::vector<DeviceHandle>& out) {
+        if (arg == "all") {
+            for (DeviceHandle handle = 0; handle < _manager.GetDeviceCount(); ++handle) {
+                out.push_back(handle);
+            }
+            return true;
+        }
+        std::size_t handle = 0;
+        if (ParseNumber(arg, handle)) {
+            if (handle >= _manager.GetDeviceCount()) return false;
+            out.push_back(handle);
+            return true;
+        }
+        // Не число — имя устройства: выбираются все устройства с этим именем
+        NameIndex::HandleRange byName = _manager.FindByName(arg);
+        if (byName.empty()) return false;
+        out.insert(out.end(), byName.begin(), byName.end());
+        return true;
+    }
+
+    static std::string_view Trim(std::string_view text) {
+        while (!text.empty() && (text.front() == ' ' || text.front() == '\t')) text.remove_prefix(1);
+        while (!text.empty() && (text.back() == ' ' || text.back() == '\t')) text.remove_suffix(1);
+        return text;
+    }
+
+    void QueueToggle(PendingOp op, std::string_view arg) {
+        if (_pendingOp != op) FlushPending();
+        _pendingOp = op;
+        if (!ResolveTargets(arg, _pending)) Error("unknown device");
+    }
+
+    // tag/untag <метка> <дескриптор|all|имя>
+    void TagCommand(bool add, std::string_view line) {
+        std::string_view tag = NextToken(line);
+        _targets.clear();
+        if (tag.empty() || !ResolveTargets(Trim(line), _targets)) {
+            Error("usage: tag|untag <tag> <handle|all|name>");
+            return;
+        }
+        for (DeviceHandle handle : _targets) {
+            if (add) _manager.Tag(handle, tag);
+            else _manager.Untag(handle, tag);
+        }
+    }
+
+    // Множество по имени метки; on и all — встроенные множества
+    bool TagSet(std::string_view tag, RoaringBitmap& out) const {
+        if (tag == "on") { out = _manager.GetOnSet(); return true; }
+        if (tag == "all") { out = _manager.GetAllSet(); return true; }
+        const RoaringBitmap* tagged = _manager.GetTagged(tag);
+        if (!tagged) return false;
+        out = *tagged;
+        return true;
+    }
+
+    // filter <выражение> [-> on|off|list [курсор]]
+    // Например: filter power > 500 && type == Drill && brand == "Bosch" -> off
+    void Filter(std::string_view line) {
+        std::string_view action;
+        std::string error;
+        if (!_filter.Compile(line, error, &action)) {
+            Error(error.c_str());
+            return;
+        }
+        RoaringBitmap selection = _filter.Evaluate(_manager);
+
+        std::string_view verb = NextToken(action);
+        if (verb.empty()) {
+            _out += "selected ";
+            AppendInt(_out, static_cast<long long>(selection.Cardinality()));
+            _out += '\n';
+        } else if (verb == "on") {
+            _manager.TurnOn(selection);
+        } else if (verb == "off") {
+            _manager.TurnOff(selection);
+        } else if (verb == "list") {
+            std::size_t cursor = 0;
+            std::string_view cursorToken = NextToken(action);
+            if (!cursorToken.empty() && !ParseNumber(cursorToken, cursor)) {
+                Error("usage: filter <expression> -> list [cursor]");
+                return;
+            }
+            _ui.RenderSelectionPage(_out, selection, cursor, kDefaultPageSize);
+        } else {
+            Error("usage: filter <expression> [-> on|off|list [cursor]]");
+        }
+    }
+
+    // sorted <power|load|name> [asc|desc] [позиция]
+    void Sorted(std::string_view line) {
+        std::string_view keyToken = NextToken(line);
+        std::string_view directionToken = NextToken(line);
+        std::string_view offsetToken = NextToken(line);
+        DeviceSortKey key;
+        if (keyToken == "power") key = DeviceSortKey::RatedPower;
+        else if (keyToken == "load") key = DeviceSortKey::Load;
+        else if (keyToken == "name") key = DeviceSortKey::Name;
+        else {
+            Error("usage: sorted <power|load|name> [asc|desc] [offset]");
+            return;
+        }
+        // По умолчанию мощности — по убыванию, имена — по возрастанию
+        bool descending = key != DeviceSortKey::Name;
+        if (directionToken == "asc") descending = false;
+        else if (directionToken == "desc") descending = true;
+        else if (!directionToken.empty()) offsetToken = directionToken;
+        std::size_t offset = 0;
+        if (!offsetToken.empty() && !ParseNumber(offsetToken, offset)) {
+            Error("usage: sorted <power|load|name> [asc|desc] [offset]");
+            return;
+        }
+        _ui.RenderOrderedPage(_out, _manager.GetSortedView(key), descending, offset, kDefaultPageSize);
+    }
+
+    // demand [window <секунд>]: окна нагрузки или новая длина окна
+    void Demand(std::string_view line) {
+        std::string_view keyword = NextToken(line);
+        if (keyword.empty()) {
+            _manager.RecordDemand();
+            _ui.RenderDemandStats(_out);
+            return;
+        }
+        std::size_t seconds = 0;
+        if (keyword != "window" || !ParseNumber(NextToken(line), seconds) || seconds == 0 ||
+            seconds > kMaxDemandWindowSeconds) {
+            Error("usage: demand [window <seconds>]");
+            return;
+        }
+        _manager.SetDemandWindow(std::chrono::seconds(static_cast<std::chrono::seconds::rep>(seconds)));
+        _manager.RecordDemand();
+        _out += "demand window ";
+        AppendInt(_out, static_cast<long long>(seconds));
+        _out += " s\n";
+    }
+
+    // select <метка> [and|or|andnot <метка>]... [-> on|off]
+    // Выражение вычисляется слева направо; с -> выборка переключается
+    void Select(std::string_view line) {
+        RoaringBitmap selection;
+        RoaringBitmap operand;
+        if (!TagSet(NextToken(line), selection)) {
+            Error("unknown tag");
+            return;
+        }
+        for (std::string_view op = NextToken(line); !op.empty(); op = NextToken(line)) {
+            if (op == "->") {
+                std::string_view action = NextToken(line);
+                if (action == "on") _manager.TurnOn(selection);
+                else if (action == "off") _manager.TurnOff(selection);
+                else Error("usage: select ... -> on|off");
+                break;
+            }
+            if ((op != "and" && op != "or" && op != "andnot") || !TagSet(NextToken(line), operand)) {
+                Error("usage: select <tag> [and|or|andnot <tag>]... [-> on|off]");
+                return;
+            }
+            if (op == "and") selection = selection & operand;
+            else if (op == "or") selection = selection | operand;
+            else selection = selection - operand;
+        }
+        _out += "selected ";
+        AppendInt(_out, static_cast<long long>(selection.Cardinality()));
+        _out += '\n';
+    }
+
+    // find: постраничный список с фильтром, условия вида ключ=значение
+    void Find(std::string_view line) {
+        DeviceFilter filter;
+        std::size_t cursor = 0;
+        std::size_t limit = kDefaultPageSize;
+        for (std::string_view token = NextToken(line); !token.empty(); token = NextToken(line)) {
+            std::size_t eq = token.find('=');
+            std::string_view key = token.substr(0, eq);
+            std::string_view value = eq == std::string_view::npos ? std::string_view() : token.substr(eq + 1);
+            std::size_t number = 0;
+            if (key == "type") {
+                _typeFilter.assign(value.data(), value.size());
+                filter.typeName = _typeFilter.c_str();
+            } else if (key == "name") {
+                filter.nameContains.assign(value.data(), value.size());
+            } else if (key == "on" && ParseNumber(value, number) && number <= 1) {
+                filter.onState = static_cast<int>(number);
+            } else if (key == "min" && ParseNumber(value, number)) {
+                filter.minPower = static_cast<int>(number);
+            } else if (key == "from" && ParseNumber(value, number)) {
+                cursor = number;
+            } else if (key == "limit" && ParseNumber(value, number) && number <= kMaxPageSize) {
+                limit = number;
+            } else {
+                Error("usage: find [type=] [name=] [on=0|1] [min=] [from=] [limit=<= 100000]");
+                return;
+            }
+        }
+        _ui.RenderDevicesPage(_out, cursor, limit, filter);
+    }
+
+    void AppendNameMatch(NameIndex::NameId id) {
+        const NameIndex& index = _manager.GetNameIndex();
+        NameIndex::HandleRange handles = index.Handles(id);
+        _out += '"';
+        _out += index.Name(id);
+        _out += "\" устройств: ";
+        AppendInt(_out, static_cast<long long>(handles.size()));
+        _out += ", первое #";
+        AppendInt(_out, static_cast<long long>(*handles.begin()));
+    }
+
+    // search: поиск по имени через индекс имён; текст — остаток строки
+    void Search(std::string_view line) {
+        std::string_view mode = NextToken(line);
+        line = Trim(line);
+        if (line.empty() || (mode != "prefix" && mode != "sub" && mode != "fuzzy")) {
+            Error("usage: search <prefix|sub|fuzzy> <text>");
+            return;
+        }
+        const NameIndex& index = _manager.GetNameIndex();
+        std::size_t shown = 0;
+        if (mode == "fuzzy") {
+            for (const auto& match : index.FindFuzzy(line, kDefaultPageSize)) {
+                AppendNameMatch(match.id);
+                _out += ", сходство ";
+                AppendInt(_out, static_cast<long long>(match.score * 100 + 0.5));
+                _out += "%\n";
+                ++shown;
+            }
+        } else {
+            auto ids = mode == "prefix" ? index.FindPrefix(line) : index.FindSubstring(line);
+            for (NameIndex::NameId id : ids) {
+                if (shown++ == kDefaultPageSize) break;
+                AppendNameMatch(id);
+                _out += '\n';
+            }
+        }
+        if (shown == 0) _out += "ничего не найдено\n";
+    }
+
+    void ExecuteLine(std::string_view line) {
+        ++_lineNumber;
+        std::string_view command = NextToken(line);
+        if (command.empty() || command[0] == '#') return;
+        if (command == "quit" || command == "exit") {
+            _quitRequested = true;
+            return;
+        }
+        ++_executed;
+
+        if (command == "on" || command == "off") {
+            // Аргумент — остаток строки: имена устройств содержат пробелы
+            QueueToggle(command == "on" ? PendingOp::On : PendingOp::Off, Trim(line));
+            return;
+        }
+
+        // Остальные команды видят результат всех предыдущих переключений
+        FlushPending();
+        if (command == "add") {
+            const DeviceFactory* factory = FindFactory(NextToken(line));
+            std::string_view countToken = NextToken(line);
+            std::size_t count = 1;
+            if (!factory || (!countToken.empty() && !ParseNumber(countToken, count))) {
+                Error("usage: add <fridge|drill> [count]");
+                return;
+            }
+            // Тот же предел, что у запроса Add сервиса управления
+            if (count > control_protocol::kMaxAddCount) {
+                Error("add count exceeds 1000000");
+                return;
+            }
+            AppendAdded(_manager.AddDevices(*factory, count), count);
+        } else if (command == "generate") {
+            FleetSpec spec;
+            std::string_view countToken = NextToken(line);
+            std::string_view seedToken = NextToken(line);
+            std::string_view ratioToken = NextToken(line);
+            std::size_t seed = spec.seed;
+            auto ratio = std::from_chars(ratioToken.data(), ratioToken.data() + ratioToken.size(), spec.onRatio);
+            // Отрицательная доля или NaN молча выключили бы весь парк
+            if (!ParseNumber(countToken, spec.count) || (!seedToken.empty() && !ParseNumber(seedToken, seed)) ||
+                (!ratioToken.empty() && (ratio.ec != std::errc() || !(spec.onRatio >= 0.0 && spec.onRatio <= 1.0)))) {
+                Error("usage: generate <count> [seed] [on ratio]");
+                return;
+            }
+            if (spec.count > control_protocol::kMaxAddCount) {
+                Error("generate count exceeds 1000000");
+                return;
+            }
+            spec.seed = seed;
+            DeviceHandle first = FleetGenerator(spec).Populate(_manager);
+            AppendAdded(first, spec.count);
+        } else if (command == "load") {
+            std::string path(Trim(line));
+            DeviceHandle first = _manager.GetDeviceCount();
+            long long count = FleetGenerator::LoadSnapshot(path.c_str(), _manager);
+            if (count < 0) {
+                Error("cannot load snapshot");
+                return;
+            }
+            AppendAdded(first, static_cast<std::size_t>(count));
+        } else if (command == "total") {
+            _out += "total ";
+            AppendInt(_out, _manager.GetTotalPower());
+            _out += '\n';
+        } else if (command == "list") {
+            std::size_t cursor = 0;
+            std::size_t pageSize = kDefaultPageSize;
+            std::string_view cursorToken = NextToken(line);
+            std::string_view sizeToken = NextToken(line);
+            if ((!cursorToken.empty() && !ParseNumber(cursorToken, cursor)) ||
+                (!sizeToken.empty() && !ParseNumber(sizeToken, pageSize)) || pageSize > kMaxPageSize) {
+                Error("usage: list [cursor] [page size <= 100000]");
+                return;
+            }
+            _ui.RenderDevicesPage(_out, cursor, pageSize);
+        } else if (command == "find") {
+            Find(line);
+        } else if (command == "search") {
+            Search(line);
+        } else if (command == "tag" || command == "untag") {
+            TagCommand(command == "tag", line);
+        } else if (command == "select") {
+            Select(line);
+        } else if (command == "filter") {
+            Filter(line);
+        } else if (command == "sorted") {
+            Sorted(line);
+        } else if (command == "top") {
+            std::size_t count = 10;
+            std::string_view countToken = NextToken(line);
+            if (!countToken.empty() && !ParseNumber(countToken, count)) {
+                Error("usage: top [N]");
+                return;
+            }
+            _ui.RenderOrderedPage(_out, _manager.TopByLoad(count), false, 0, count);
+        } else if (command == "memory") {
+            _ui.RenderMemoryStats(_out);
+        } else if (command == "latency") {
+            _ui.RenderLatencyStats(_out);
+        } else if (command == "demand") {
+            Demand(line);
+        } else if (command == "sketches") {
+            std::size_t count = 5;
+            std::string_view countToken = NextToken(line);
+            if (!countToken.empty() && !ParseNumber(countToken, count)) {
+                Error("usage: sketches [N]");
+                return;
+            }
+            _ui.RenderSketches(_out, count);
+        } else if (command == "help") {
+            _out += "commands: add <fridge|drill> [count], generate <count> [seed] [on ratio], load <snapshot>,\n"
+                    "          on <handle|all|name>, off <handle|all|name>, total,\n"
+                    "          list [cursor] [page size], find [type=] [name=] [on=] [min=] [from=] [limit=],\n"
+                    "          search <prefix|sub|fuzzy> <text>, tag|untag <tag> <handle|all|name>,\n"
+                    "          select <tag> [and|or|andnot <tag>]... [-> on|off],\n"
+                    "          filter <expression> [-> on|off|list [cursor]],\n"
+                    "          sorted <power|load|name> [asc|desc] [offset], top [N], memory, latency,\n"
+                    "          demand [window <seconds>], sketches [N]\n";
+        } else {
+            Error("unknown command");
+        }
+    }
+
+public:
+    CommandProcessor(DeviceManager& manager, int outFd = 1)
+        : _manager(manager), _ui(manager, nullptr, outFd), _outFd(outFd) {}
+
+    // Выполняет все полные строки text и возвращает число разобранных байт;
+    // незавершённый хвост остаётся вызывающему
+    std::size_t ExecuteBlock(std::string_view text) {
+        std::size_t consumed = 0;
+        while (!_quitRequested) {
+            std::size_t end = text.find('\n', consumed);
+            if (end == std::string_view::npos) break;
+            std::string_view line = text.substr(consumed, end - consumed);
+            if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+            ExecuteLine(line);
+            consumed = end + 1;
+        }
+        FlushPending();
+        _manager.SampleDemand();
+        return consumed;
+    }
+
+    bool IsQuitRequested() const { return _quitRequested; }
+
+    // Число выполненных команд (без пустых строк и комментариев)
+    std::size_t GetExecutedCount() const { return _executed; }
+
+    // Ответы, ещё не выведенные в дескриптор
+    std::string& Output() { return _out; }
+
+    // Читает поток до конца; ответы выводятся после каждого блока
+    void Run(std::FILE* in) {
+        std::vector<char> buffer(kReadBytes);
+        std::size_t filled = 0;
+        while (true) {
+            if (filled == buffer.size()) buffer.resize(buffer.size() * 2);
+            std::size_t read = std::fread(buffer.data() + filled, 1, buffer.size() - filled, in);
+            filled += read;
+            bool eof = read == 0;
+            if (eof && filled > 0 && buffer[filled - 1] != '\n') {
+                // Последняя строка без перевода строки
+                if (filled == buffer.size()) buffer.push_back('\n');
+                else buffer[filled] = '\n';
+                ++filled;
+            }
+
+            std::size_t consumed = ExecuteBlock(std::string_view(buffer.data(), filled));
+            std::memmove(buffer.data(), buffer.data() + consumed, filled - consumed);
+            filled -= consumed;
+
+            WriteAll(_outFd, _out.data(), _out.size());
+            _out.clear();
+            if (eof || _quitRequested) break;
+        }
+    }
+};
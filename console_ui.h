@@ -0,0 +1,291 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "demand_window.h"
+#include "device_manager.h"
+#include "fleet_sketches.h"
+#include "latency_histogram.h"
+#include "logger.h"
+#include "memory_accounting.h"
+#include "profiler.h"
+#include "sharded_counter.h"
+
+// Записывает буфер в дескриптор целиком, повторяя write при частичной записи
+inline bool WriteAll(int fd, const char* data, std::size_t size) {
+    while (size > 0) {
+#ifdef _WIN32
+        int written = _write(fd, data, static_cast<unsigned>(size));
+#else
+        ssize_t written = ::write(fd, data, size);
+#endif
+        if (written <= 0) return false;
+        data += written;
+        size -= static_cast<std::size_t>(written);
+    }
+    return true;
+}
+
+// Дописывает в buffer строку по формату printf. Строка длиннее line
+// обрезается: snprintf возвращает длину без обрезки, и дописывать столько
+// байт из line нельзя
+template <typename... Args>
+inline void AppendFormat(std::string& buffer, const char* format, Args... args) {
+    char line[192];
+    int length = std::snprintf(line, sizeof(line), format, args...);
+    if (length <= 0) return;
+    buffer.append(line, std::min(static_cast<std::size_t>(length), sizeof(line) - 1));
+}
+
+// === Интерфейс пользователя ===
+class ConsoleUI {
+private:
+    // Размер страницы вывода: список больше этого размера уходит
+    // несколькими крупными write, а не одним гигантским буфером
+    static constexpr std::size_t kPageBytes = 1 << 20;
+
+    DeviceManager& _manager;
+    std::shared_ptr<ILogger> _logger;
+    int _fd;
+
+    // Сбрасывает накопленный текст одним системным вызовом.
+    // std::cout сбрасывается заранее, чтобы не перепутать порядок строк
+    void Flush(std::string& buffer) const {
+        if (buffer.empty()) return;
+        PROFILE_SCOPE("ConsoleUI::Flush");
+        PROFILE_COUNT("ConsoleUI.bytesWritten", buffer.size());
+        OperationalStats::Get().bytesWritten.Add(static_cast<std::int64_t>(buffer.size()));
+        std::cout.flush();
+        WriteAll(_fd, buffer.data(), buffer.size());
+        buffer.clear();
+    }
+
+public:
+    ConsoleUI(DeviceManager& manager, std::shared_ptr<ILogger> logger, int fd = 1)
+        : _manager(manager), _logger(logger), _fd(fd) {}
+
+    // Дописывает список устройств в буфер; при переполнении страницы
+    // выводит её и продолжает с пустого буфера
+    void RenderDevices(std::string& buffer, bool flushPages) const {
+        PROFILE_SCOPE("ConsoleUI::RenderDevices");
+        const auto& devices = _manager.GetDevices();
+        buffer += "\nСписок устройств:\n";
+        for (const auto& device : devices) {
+            device->AppendInfo(buffer);
+            buffer += '\n';
+            if (flushPages && buffer.size() >= kPageBytes) Flush(buffer);
+        }
+    }
+
+    void ShowDevices() const {
+        PROFILE_SCOPE("ConsoleUI::ShowDevices");
+        std::string buffer;
+        buffer.reserve(kPageBytes + 256);
+        RenderDevices(buffer, true);
+        Flush(buffer);
+    }
+
+    // Дописывает в buffer одну страницу отфильтрованного списка и возвращает
+    // курсор следующей страницы; остальные устройства не форматируются
+    DeviceHandle RenderDevicesPage(std::string& buffer, DeviceHandle cursor, std::size_t pageSize,
+                                   const DeviceFilter& filter = {}) const {
+        DevicePage page = _manager.ListPage(cursor, pageSize, filter);
+        buffer += "\nСписок устройств (с #";
+        AppendUnsigned(buffer, cursor);
+        buffer += "):\n";
+        for (DeviceHandle handle : page.handles) {
+            buffer += '#';
+            AppendInt(buffer, static_cast<long long>(handle));
+            buffer += ' ';
+            _manager.GetDevice(handle).AppendInfo(buffer);
+            buffer += '\n';
+        }
+        if (page.hasMore) {
+            buffer += "Следующая страница: курсор #";
+            AppendUnsigned(buffer, page.nextCursor);
+            buffer += '\n';
+        } else {
+            buffer += "Конец списка\n";
+        }
+        return page.nextCursor;
+    }
+
+    // То же для готовой выборки (результат фильтра или запроса по меткам)
+    DeviceHandle RenderSelectionPage(std::string& buffer, const RoaringBitmap& selection,
+                                     DeviceHandle cursor, std::size_t pageSize) const {
+        buffer += "\nВыбрано устройств: ";
+        AppendInt(buffer, static_cast<long long>(selection.Cardinality()));
+        buffer += '\n';
+        std::size_t shown = 0;
+        DeviceHandle next = cursor;
+        bool hasMore = false;
+        // Курсор за пределами 32-битных дескрипторов выборки — конец списка,
+        // а не усечённая позиция в её начале
+        if (cursor > std::numeric_limits<std::uint32_t>::max()) {
+            buffer += "Конец списка\n";
+            return cursor;
+        }
+        selection.ForEachFrom(static_cast<std::uint32_t>(cursor), [&](std::uint32_t handle) {
+            if (shown == pageSize) {
+                hasMore = true;
+                return false;
+            }
+            buffer += '#';
+            AppendInt(buffer, static_cast<long long>(handle));
+            buffer += ' ';
+            _manager.GetDevice(handle).AppendInfo(buffer);
+            buffer += '\n';
+            ++shown;
+            next = handle + 1;
+            return true;
+        });
+        if (hasMore) {
+            buffer += "Следующая страница: курсор #";
+            AppendUnsigned(buffer, next);
+            buffer += '\n';
+        } else {
+            buffer += "Конец списка\n";
+        }
+        return next;
+    }
+
+    // Страница упорядоченного представления: позиции [offset, offset + pageSize)
+    // перестановки order, при descending — с её конца
+    void RenderOrderedPage(std::string& buffer, const std::vector<std::uint32_t>& order, bool descending,
+                           std::size_t offset, std::size_t pageSize) const {
+        std::size_t end = std::min(order.size(), offset + pageSize);
+        for (std::size_t pos = offset; pos < end; ++pos) {
+            std::uint32_t handle = descending ? order[order.size() - 1 - pos] : order[pos];
+            AppendInt(buffer, static_cast<long long>(pos + 1));
+            buffer += ". #";
+            AppendInt(buffer, static_cast<long long>(handle));
+            buffer += ' ';
+            _manager.GetDevice(handle).AppendInfo(buffer);
+            buffer += '\n';
+        }
+        if (end < order.size()) {
+            buffer += "Следующая страница: позиция ";
+            AppendInt(buffer, static_cast<long long>(end));
+            buffer += '\n';
+        } else {
+            buffer += "Конец списка\n";
+        }
+    }
+
+    DeviceHandle ShowDevicesPage(DeviceHandle cursor, std::size_t pageSize,
+                                 const DeviceFilter& filter = {}) const {
+        std::string buffer;
+        DeviceHandle next = RenderDevicesPage(buffer, cursor, pageSize, filter);
+        Flush(buffer);
+        return next;
+    }
+
+    // Дописывает в buffer память по подсистемам: живые байты и пик
+    void RenderMemoryStats(std::string& buffer) const {
+        MemorySnapshot stats = _manager.MemoryStats();
+        if (!stats.tracked) {
+            buffer += "Учёт памяти не включён в сборку (ELECTRIC_DEVICES_MEMORY_ACCOUNTING)\n";
+            return;
+        }
+        buffer += "Память по подсистемам, КиБ (сейчас / пик):\n";
+        for (std::size_t i = 0; i < static_cast<std::size_t>(MemoryTag::Count); ++i) {
+            const MemoryUsage& usage = stats.usage[i];
+            AppendFormat(buffer, "  %-8s %12.1f / %12.1f\n", MemoryTagName(static_cast<MemoryTag>(i)),
+                         static_cast<double>(usage.liveBytes) / 1024.0, static_cast<double>(usage.peakBytes) / 1024.0);
+        }
+        AppendFormat(buffer, "  %-8s %12.1f\n", "total", static_cast<double>(stats.TotalLiveBytes()) / 1024.0);
+    }
+
+    // Дописывает в buffer перцентили задержек управляющих операций, мкс
+    void RenderLatencyStats(std::string& buffer) const {
+        if (!LatencyStats::kEnabled) {
+            buffer += "Гистограммы задержек не включены в сборку (ELECTRIC_DEVICES_LATENCY_HISTOGRAMS)\n";
+            return;
+        }
+        buffer += "Задержки операций, мкс:\n";
+        AppendFormat(buffer, "  %-14s %10s %9s %9s %9s %9s %9s\n", "operation", "count", "p50", "p90", "p99", "p99.9",
+                     "max");
+        LatencySnapshot latency;
+        for (std::size_t i = 0; i < static_cast<std::size_t>(LatencyOp::Count); ++i) {
+            LatencyStats::Snapshot(static_cast<LatencyOp>(i), latency);
+            AppendFormat(buffer, "  %-14s %10llu %9.3f %9.3f %9.3f %9.3f %9.3f\n",
+                         LatencyOpName(static_cast<LatencyOp>(i)), static_cast<unsigned long long>(latency.count),
+                         latency.PercentileNs(50) / 1e3, latency.PercentileNs(90) / 1e3,
+                         latency.PercentileNs(99) / 1e3, latency.PercentileNs(99.9) / 1e3, latency.MaxNs() / 1e3);
+        }
+    }
+
+    // Окна нагрузки парка и групп: текущая выборка, пик, среднее по времени
+    // и расчётный пик (наибольшее среднее), Вт
+    void RenderDemandStats(std::string& buffer) const {
+        auto now = std::chrono::steady_clock::now();
+        AppendFormat(buffer, "Нагрузка за последние %lld с, W:\n",
+                     static_cast<long long>(
+                         std::chrono::duration_cast<std::chrono::seconds>(_manager.GetDemandWindow()).count()));
+        AppendFormat(buffer, "  %-14s %14s %14s %14s %14s %8s\n", "scope", "current", "peak", "mean", "peak mean",
+                     "samples");
+        auto row = [&](const char* scope, const DemandStats& demand) {
+            AppendFormat(buffer, "  %-14s %14lld %14lld %14.0f %14.0f %8zu\n", scope, demand.current, demand.peak,
+                         demand.mean, demand.peakMean, demand.samples);
+        };
+        row("site", _manager.GetSiteDemand(now));
+        const std::vector<DeviceGroupStats>& groups = _manager.GetGroups();
+        for (std::size_t i = 0; i < groups.size(); ++i) row(groups[i].name, _manager.GetGroupDemand(i, now));
+    }
+
+    // Отчёт по скетчам парка: квантили номинальной мощности, число
+    // производителей (оценка и точное из словаря) и частые модели
+    void RenderSketches(std::string& buffer, std::size_t topCount = 5) const {
+        const FleetSketches& sketches = _manager.GetSketches();
+        AppendFormat(buffer, "Номинальная мощность, W (%llu устройств): p50 %d, p90 %d, p99 %d, min %d, max %d\n",
+                     static_cast<unsigned long long>(sketches.ratedPower.Count()), sketches.ratedPower.Quantile(0.5),
+                     sketches.ratedPower.Quantile(0.9), sketches.ratedPower.Quantile(0.99),
+                     sketches.ratedPower.Min(), sketches.ratedPower.Max());
+        AppendFormat(buffer, "Производителей: ~%.0f (точно %zu)\n", sketches.brands.Estimate(),
+                     _manager.GetBrandCount());
+        auto top = [&](const char* title, const SpaceSaving& summary) {
+            AppendFormat(buffer, "%s (всего %llu):\n", title, static_cast<unsigned long long>(summary.Total()));
+            for (const SpaceSaving::Entry& entry : summary.Top(topCount)) {
+                // Модель («производитель тип») бывает длиннее строки формата:
+                // она дописывается целиком и выравнивается пробелами
+                buffer += "  ";
+                buffer += entry.label;
+                if (entry.label.size() < 28) buffer.append(28 - entry.label.size(), ' ');
+                AppendFormat(buffer, " %12llu ± %llu\n", static_cast<unsigned long long>(entry.count),
+                             static_cast<unsigned long long>(entry.error));
+            }
+        };
+        top("Частые модели", sketches.models);
+        top("Чаще всего включаемые модели", sketches.switchOns);
+    }
+
+    void ShowMemoryStats() const {
+        std::string buffer;
+        RenderMemoryStats(buffer);
+        Flush(buffer);
+    }
+
+    void ShowTotalPower() const {
+        PROFILE_SCOPE("ConsoleUI::ShowTotalPower");
+        long long total = _manager.GetTotalPower();
+        std::cout << "Общая мощность: " << total << " W\n";
+        if (_logger->IsEnabled(LogLevel::Info)) {
+            _logger->Log("Общая мощность потребления: " + std::to_string(total) + " W");
+        }
+    }
+};
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// === Двоичный протокол управления парком ===
+// Кадр: длина тела (uint32, little-endian) и тело. Запросы можно слать
+// подряд, не дожидаясь ответов; ответы приходят в том же порядке.
+//
+// Запрос: код операции (uint8) и аргументы:
+//   Add   — тип (uint8: 0 холодильник, 1 дрель), количество (uint32);
+//   On, Off, Query — дескриптор устройства (uint32);
+//   Total — без аргументов.
+// Ответ: статус (uint8) и, при Ok, данные:
+//   Add   — дескриптор первого добавленного (uint32);
+//   On, Off — ничего;
+//   Query — включено (uint8), мощность (int32);
+//   Total — мощность (int64), устройств (uint64), включено (uint64).
+// Все целые — little-endian
+
+namespace control_protocol {
+
+enum class Op : std::uint8_t { Add = 1, On = 2, Off = 3, Query = 4, Total = 5 };
+enum class Status : std::uint8_t { Ok = 0, BadHandle = 1, BadRequest = 2 };
+enum class DeviceType : std::uint8_t { Fridge = 0, Drill = 1 };
+
+constexpr std::size_t kLengthBytes = 4;
+// Ни запрос, ни ответ протокола не длиннее; кадр больше — ошибка клиента
+constexpr std::size_t kMaxFrameBytes = 64;
+// За один запрос Add — не больше стольких устройств
+constexpr std::uint32_t kMaxAddCount = 1000000;
+
+inline void PutU8(std::string& out, std::uint8_t value) { out += static_cast<char>(value); }
+
+inline void PutU32(std::string& out, std::uint32_t value) {
+    char bytes[4];
+    for (int i = 0; i < 4; ++i) bytes[i] = static_cast<char>(value >> (8 * i));
+    out.append(bytes, 4);
+}
+
+inline void PutU64(std::string& out, std::uint64_t value) {
+    char bytes[8];
+    for (int i = 0; i < 8; ++i) bytes[i] = static_cast<char>(value >> (8 * i));
+    out.append(bytes, 8);
+}
+
+inline std::uint32_t GetU32(const char* data) {
+    std::uint32_t value = 0;
+    for (int i = 0; i < 4; ++i) value |= static_cast<std::uint32_t>(static_cast<unsigned char>(data[i])) << (8 * i);
+    return value;
+}
+
+inline std::uint64_t GetU64(const char* data) {
+    std::uint64_t value = 0;
+    for (int i = 0; i < 8; ++i) value |= static_cast<std::uint64_t>(static_cast<unsigned char>(data[i])) << (8 * i);
+    return value;
+}
+
+// --- Кодирование запросов (для клиентов) ---
+
+inline void AppendAdd(std::string& out, DeviceType type, std::uint32_t count) {
+    PutU32(out, 6);
+    PutU8(out, static_cast<std::uint8_t>(Op::Add));
+    PutU8(out, static_cast<std::uint8_t>(type));
+    PutU32(out, count);
+}
+
+// Op::On, Op::Off или Op::Query
+inline void AppendHandleOp(std::string& out, Op op, std::uint32_t handle) {
+    PutU32(out, 5);
+    PutU8(out, static_cast<std::uint8_t>(op));
+    PutU32(out, handle);
+}
+
+inline void AppendTotal(std::string& out) {
+    PutU32(out, 1);
+    PutU8(out, static_cast<std::uint8_t>(Op::Total));
+}
+
+// Длина первого кадра в data, если он пришёл целиком (вместе с префиксом
+// длины), 0 — если ещё не весь; size_t(-1) — длина недопустима
+inline std::size_t CompleteFrame(const char* data, std::size_t size) {
+    if (size < kLengthBytes) return 0;
+    std::uint32_t length = GetU32(data);
+    if (length == 0 || length > kMaxFrameBytes) return static_cast<std::size_t>(-1);
+    return size - kLengthBytes >= length ? kLengthBytes + length : 0;
+}
+
+}  // namespace control_protocol
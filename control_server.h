@@ -0,0 +1,347 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#ifndef _WIN32
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstring>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#include "control_protocol.h"
+#include "device_manager.h"
+#include "devices.h"
+
+// === TCP-сервис управления парком ===
+// Цикл событий epoll в одном потоке; этот поток — единственный владелец
+// DeviceManager на время работы сервера (DeviceManager не потокобезопасен,
+// поэтому второй цикл на другом ядре пришлось бы синхронизировать с первым).
+// Протокол — control_protocol.h.
+//
+// За один проход цикла читаются все готовые соединения и разбираются все
+// пришедшие целиком запросы. Идущие подряд On (или Off) — в том числе из
+// разных соединений — копятся в пакет и применяются одним вызовом
+// DeviceManager::TurnOn/TurnOff; Add, Query и Total сначала применяют
+// накопленный пакет. Ответы уходят после применения пакета, так что
+// ответ Ok означает, что изменение уже видно всем клиентам.
+// Пока ответы соединения не отправлены, его запросы не читаются.
+// На Windows не поддерживается: Start возвращает false
+class ControlServer {
+private:
+    // Не больше стольких байт запросов с одного соединения за проход цикла
+    static constexpr std::size_t kMaxReadPerPass = 256 * 1024;
+
+    DeviceManager& _manager;
+    RefrigeratorFactory _fridgeFactory;
+    DrillFactory _drillFactory;
+    std::function<void()> _batchHook;
+    int _listenFd = -1;
+    int _wakeFd = -1;
+    int _epollFd = -1;
+    std::uint16_t _port = 0;
+    std::thread _thread;
+
+    struct Connection {
+        std::string request;
+        std::string response;
+        std::size_t sent = 0;
+        bool writing = false;  // ждём EPOLLOUT, чтение приостановлено
+        bool closed = false;   // recv вернул 0: клиент закрыл свою сторону и всё прочитано
+    };
+
+#ifndef _WIN32
+    std::unordered_map<int, Connection> _connections;
+    std::vector<int> _touched;
+    std::vector<DeviceHandle> _pending;
+    control_protocol::Op _pendingOp = control_protocol::Op::On;
+
+    bool Fail(const char* what, std::string& error) {
+        error = what;
+        error += ": ";
+        error += std::strerror(errno);
+        Close();
+        return false;
+    }
+
+    void Close() {
+        if (_listenFd >= 0) ::close(_listenFd);
+        if (_wakeFd >= 0) ::close(_wakeFd);
+        if (_epollFd >= 0) ::close(_epollFd);
+        _listenFd = _wakeFd = _epollFd = -1;
+    }
+
+    void Drop(int fd) {
+        ::epoll_ctl(_epollFd, EPOLL_CTL_DEL, fd, nullptr);
+        ::close(fd);
+        _connections.erase(fd);
+    }
+
+    void Watch(int fd, std::uint32_t events) {
+        epoll_event event{};
+        event.events = events;
+        event.data.fd = fd;
+        ::epoll_ctl(_epollFd, EPOLL_CTL_MOD, fd, &event);
+    }
+
+    void Accept() {
+        for (;;) {
+            int fd = ::accept4(_listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (fd < 0) return;
+            int one = 1;
+            ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            epoll_event event{};
+            event.events = EPOLLIN | EPOLLRDHUP;
+            event.data.fd = fd;
+            if (::epoll_ctl(_epollFd, EPOLL_CTL_ADD, fd, &event) != 0) {
+                ::close(fd);
+                continue;
+            }
+            _connections[fd];
+        }
+    }
+
+    // --- Применение запросов ---
+
+    void ApplyPending() {
+        if (_pending.empty()) return;
+        if (_pendingOp == control_protocol::Op::On) _manager.TurnOn(_pending);
+        else _manager.TurnOff(_pending);
+        _pending.clear();
+    }
+
+    static void Reply(std::string& out, control_protocol::Status status, std::size_t bodyBytes = 0) {
+        control_protocol::PutU32(out, static_cast<std::uint32_t>(1 + bodyBytes));
+        control_protocol::PutU8(out, static_cast<std::uint8_t>(status));
+    }
+
+    void Execute(const char* body, std::size_t length, std::string& out) {
+        using namespace control_protocol;
+        Op op = static_cast<Op>(body[0]);
+        switch (op) {
+            case Op::On:
+            case Op::Off: {
+                if (length != 5) return Reply(out, Status::BadRequest);
+                DeviceHandle handle = GetU32(body + 1);
+                // Число устройств меняет только Add, а он применяет пакет заранее,
+                // поэтому дескриптор можно проверить до применения
+                if (handle >= _manager.GetDeviceCount()) return Reply(out, Status::BadHandle);
+                if (op != _pendingOp) ApplyPending();
+                _pendingOp = op;
+                _pending.push_back(handle);
+                return Reply(out, Status::Ok);
+            }
+            case Op::Add: {
+                if (length != 6) return Reply(out, Status::BadRequest);
+                DeviceType type = static_cast<DeviceType>(body[1]);
+                std::uint32_t count = GetU32(body + 2);
+                const DeviceFactory* factory = type == DeviceType::Fridge  ? static_cast<const DeviceFactory*>(&_fridgeFactory)
+                                               : type == DeviceType::Drill ? &_drillFactory
+                                                                           : nullptr;
+                if (!factory || count == 0 || count > kMaxAddCount) return Reply(out, Status::BadRequest);
+                ApplyPending();
+                DeviceHandle first = _manager.AddDevices(*factory, count);
+                Reply(out, Status::Ok, 4);
+                return PutU32(out, static_cast<std::uint32_t>(first));
+            }
+            case Op::Query: {
+                if (length != 5) return Reply(out, Status::BadRequest);
+                DeviceHandle handle = GetU32(body + 1);
+                if (handle >= _manager.GetDeviceCount()) return Reply(out, Status::BadHandle);
+                ApplyPending();
+                const AbstractElectricDevice& device = *_manager.GetDevices()[handle];
+                Reply(out, Status::Ok, 5);
+                PutU8(out, device.IsOn() ? 1 : 0);
+                return PutU32(out, static_cast<std::uint32_t>(device.GetPower()));
+            }
+            case Op::Total: {
+                if (length != 1) return Reply(out, Status::BadRequest);
+                ApplyPending();
+                Reply(out, Status::Ok, 24);
+                PutU64(out, static_cast<std::uint64_t>(_manager.GetTotalPower()));
+                PutU64(out, _manager.GetDeviceCount());
+                return PutU64(out, _manager.GetOnCount());
+            }
+        }
+        Reply(out, Status::BadRequest);
+    }
+
+    // Разбирает все целые кадры; false — кадр недопустимой длины
+    bool ExecuteAll(Connection& connection) {
+        const char* data = connection.request.data();
+        std::size_t size = connection.request.size();
+        std::size_t offset = 0;
+        for (;;) {
+            std::size_t frame = control_protocol::CompleteFrame(data + offset, size - offset);
+            if (frame == static_cast<std::size_t>(-1)) return false;
+            if (frame == 0) break;
+            Execute(data + offset + control_protocol::kLengthBytes, frame - control_protocol::kLengthBytes,
+                    connection.response);
+            offset += frame;
+        }
+        connection.request.erase(0, offset);
+        return true;
+    }
+
+    // --- Ввод-вывод ---
+
+    // EPOLLRDHUP не закрывает соединение: за проход читается не больше
+    // kMaxReadPerPass, и запросы, отправленные до полузакрытия, ещё лежат
+    // в сокете. Конец потока — только recv, вернувший 0
+    void Read(int fd) {
+        auto found = _connections.find(fd);
+        if (found == _connections.end()) return;
+        Connection& connection = found->second;
+        if (connection.writing) return;
+
+        char chunk[16384];
+        std::size_t received = 0;
+        while (received < kMaxReadPerPass) {
+            ssize_t read = ::recv(fd, chunk, sizeof(chunk), 0);
+            if (read > 0) {
+                connection.request.append(chunk, static_cast<std::size_t>(read));
+                received += static_cast<std::size_t>(read);
+                continue;
+            }
+            if (read == 0) connection.closed = true;
+            else if (errno != EAGAIN) return Drop(fd);
+            break;
+        }
+        if (!ExecuteAll(connection)) return Drop(fd);
+        _touched.push_back(fd);
+    }
+
+    // Отправляет накопленные ответы; если сокет заполнен — ждёт EPOLLOUT
+    void Write(int fd) {
+        auto found = _connections.find(fd);
+        if (found == _connections.end()) return;
+        Connection& connection = found->second;
+        while (connection.sent < connection.response.size()) {
+            ssize_t written = ::send(fd, connection.response.data() + connection.sent,
+                                     connection.response.size() - connection.sent, MSG_NOSIGNAL);
+            if (written < 0) {
+                if (errno != EAGAIN) return Drop(fd);
+                // Без EPOLLRDHUP: полузакрытое соединение иначе будило бы цикл
+                // на каждом проходе, пока ответы ждут места в сокете
+                if (!connection.writing) Watch(fd, EPOLLOUT);
+                connection.writing = true;
+                return;
+            }
+            connection.sent += static_cast<std::size_t>(written);
+        }
+        connection.response.clear();
+        connection.sent = 0;
+        if (connection.closed) return Drop(fd);
+        if (connection.writing) {
+            connection.writing = false;
+            Watch(fd, EPOLLIN | EPOLLRDHUP);
+        }
+    }
+
+    void Loop() {
+        epoll_event events[256];
+        for (;;) {
+            int ready = ::epoll_wait(_epollFd, events, 256, -1);
+            if (ready < 0 && errno == EINTR) continue;
+            if (ready < 0) return;
+            for (int i = 0; i < ready; ++i) {
+                int fd = events[i].data.fd;
+                if (fd == _wakeFd) {
+                    for (auto& connection : _connections) ::close(connection.first);
+                    _connections.clear();
+                    return;
+                }
+                if (fd == _listenFd) Accept();
+                else if (events[i].events & EPOLLOUT) Write(fd);
+                else Read(fd);
+            }
+            if (_touched.empty()) continue;
+            ApplyPending();
+            for (int fd : _touched) Write(fd);
+            _touched.clear();
+            if (_batchHook) _batchHook();
+        }
+    }
+#endif
+
+public:
+    explicit ControlServer(DeviceManager& manager) : _manager(manager) {}
+
+    ~ControlServer() { Stop(); }
+
+    ControlServer(const ControlServer&) = delete;
+    ControlServer& operator=(const ControlServer&) = delete;
+
+    // Вызывается потоком сервера после каждого прохода с запросами, например
+    // для публикации метрик. Задаётся до Start
+    void SetBatchHook(std::function<void()> hook) { _batchHook = std::move(hook); }
+
+    // Запускает сервер на 127.0.0.1:port (0 — любой свободный порт). С этого
+    // момента и до Stop DeviceManager принадлежит потоку сервера.
+    // При ошибке возвращает false и описание в error
+    bool Start(std::uint16_t port, std::string& error) {
+#ifdef _WIN32
+        (void)port;
+        error = "control server is not supported on Windows";
+        return false;
+#else
+        if (_thread.joinable()) {
+            error = "control server is already running";
+            return false;
+        }
+        _listenFd = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (_listenFd < 0) return Fail("socket", error);
+        int reuse = 1;
+        ::setsockopt(_listenFd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(port);
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (::bind(_listenFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+            return Fail("bind", error);
+        }
+        if (::listen(_listenFd, 256) != 0) return Fail("listen", error);
+        socklen_t length = sizeof(address);
+        ::getsockname(_listenFd, reinterpret_cast<sockaddr*>(&address), &length);
+        _port = ntohs(address.sin_port);
+
+        _wakeFd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (_wakeFd < 0) return Fail("eventfd", error);
+        _epollFd = ::epoll_create1(EPOLL_CLOEXEC);
+        if (_epollFd < 0) return Fail("epoll_create1", error);
+        for (int fd : {_listenFd, _wakeFd}) {
+            epoll_event event{};
+            event.events = EPOLLIN;
+            event.data.fd = fd;
+            if (::epoll_ctl(_epollFd, EPOLL_CTL_ADD, fd, &event) != 0) return Fail("epoll_ctl", error);
+        }
+        _thread = std::thread([this] { Loop(); });
+        return true;
+#endif
+    }
+
+    void Stop() {
+#ifndef _WIN32
+        if (!_thread.joinable()) return;
+        std::uint64_t one = 1;
+        ssize_t written = ::write(_wakeFd, &one, sizeof(one));
+        (void)written;
+        _thread.join();
+        Close();
+#endif
+    }
+
+    std::uint16_t Port() const { return _port; }
+};
@@ -0,0 +1,236 @@
+#pragma once
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "console_ui.h"
+#include "device_manager.h"
+#include "profiler.h"
+
+// === Панель мониторинга с частичной перерисовкой ===
+// Кадр строится как набор строк; на терминал уходят только изменившиеся
+// участки строк (переход курсора ANSI + новый текст). Если ни менеджер,
+// ни окна нагрузки не менялись с прошлого кадра, кадр не строится вовсе.
+// Топ потребителей менеджер ведёт инкрементально (TrackTopByLoad),
+// поэтому кадр не обходит парк
+class Dashboard {
+private:
+    // Одинаковые участки короче этого склеиваются с соседними изменениями
+    static constexpr std::size_t kMergeGap = 8;
+
+    DeviceManager& _manager;
+    int _fd;
+    std::size_t _topCount;
+
+    std::vector<std::string> _shown;
+    std::vector<std::string> _frame;
+    std::vector<std::uint32_t> _top;
+    std::uint64_t _shownVersion = 0;
+    std::uint64_t _shownDemandVersion = 0;
+    bool _hasFrame = false;
+
+    static void AppendPadded(std::string& line, long long value, std::size_t width) {
+        char digits[24];
+        auto res = std::to_chars(digits, digits + sizeof(digits), value);
+        std::size_t length = static_cast<std::size_t>(res.ptr - digits);
+        if (length < width) line.append(width - length, ' ');
+        line.append(digits, length);
+    }
+
+    static bool IsContinuation(char c) { return (static_cast<unsigned char>(c) & 0xC0) == 0x80; }
+
+    static std::size_t Column(const std::string& line, std::size_t bytes) {
+        std::size_t column = 0;
+        for (std::size_t i = 0; i < bytes; ++i) {
+            if (!IsContinuation(line[i])) ++column;
+        }
+        return column;
+    }
+
+    void BuildFrame() {
+        _frame.clear();
+        const auto& devices = _manager.GetDevices();
+
+        std::string line = "=== Панель мониторинга ===";
+        _frame.push_back(line);
+
+        line = "Устройств: ";
+        AppendPadded(line, static_cast<long long>(devices.size()), 10);
+        line += "  Включено: ";
+        AppendPadded(line, static_cast<long long>(_manager.GetOnCount()), 10);
+        line += "  Общая мощность: ";
+        AppendPadded(line, _manager.GetTotalPower(), 14);
+        line += " W";
+        _frame.push_back(line);
+
+        // Окно нагрузки: пик выборок, среднее и наибольшее среднее (расчётный пик)
+        DemandStats demand = _manager.GetSiteDemand();
+        line = "За ";
+        AppendInt(line, static_cast<long long>(
+                            std::chrono::duration_cast<std::chrono::minutes>(_manager.GetDemandWindow()).count()));
+        line += " мин: пик ";
+        AppendPadded(line, demand.peak, 14);
+        line += " W  среднее ";
+        AppendPadded(line, static_cast<long long>(demand.mean), 14);
+        line += " W  расчётный пик ";
+        AppendPadded(line, static_cast<long long>(demand.peakMean), 14);
+        line += " W";
+        _frame.push_back(line);
+        _frame.emplace_back();
+
+        // Отбор из отслеживаемых менеджером кандидатов; выключенные не показываются
+        std::vector<std::uint32_t>& top = _top;
+        _manager.TopByLoad(_topCount, top);
+        const auto& load = _manager.GetLoadColumn();
+        while (!top.empty() && load[top.back()] <= 0) top.pop_back();
+
+        _frame.push_back("Топ потребителей:");
+        for (std::size_t rank = 0; rank < _topCount; ++rank) {
+            line = "  ";
+            AppendPadded(line, static_cast<long long>(rank + 1), 2);
+            line += ". ";
+            if (rank < top.size()) {
+                const auto& device = *devices[top[rank]];
+                line += "#";
+                AppendInt(line, static_cast<long long>(top[rank]));
+                line += " ";
+                line += device.GetName();
+                line += " (";
+                line += device.GetTypeName();
+                line += ") ";
+                AppendPadded(line, load[top[rank]], 8);
+                line += " W";
+            } else {
+                line += "-";
+            }
+            _frame.push_back(line);
+        }
+        _frame.emplace_back();
+
+        _frame.push_back("Нагрузка по группам:");
+        for (const auto& group : _manager.GetGroups()) {
+            line = "  ";
+            line += group.name;
+            line += ": ";
+            AppendPadded(line, group.power, 14);
+            line += " W, включено ";
+            AppendInt(line, static_cast<long long>(group.onCount));
+            line += "/";
+            AppendInt(line, static_cast<long long>(group.count));
+            _frame.push_back(line);
+        }
+    }
+
+    // Перевод курсора в позицию (row, столбец байта first) и текст отрезка
+    static void AppendSpan(std::string& out, std::size_t row, const std::string& line,
+                           std::size_t first, std::size_t last) {
+        out += "\x1b[";
+        AppendInt(out, static_cast<long long>(row + 1));
+        out += ';';
+        AppendInt(out, static_cast<long long>(Column(line, first) + 1));
+        out += 'H';
+        out.append(line, first, last - first);
+    }
+
+    // Дописывает в out команды перерисовки строк, отличающихся от показанных
+    void DiffInto(std::string& out) {
+        if (_shown.size() < _frame.size()) _shown.resize(_frame.size());
+        const std::string empty;
+        for (std::size_t row = 0; row < _shown.size(); ++row) {
+            const std::string& oldLine = _shown[row];
+            const std::string& newLine = row < _frame.size() ? _frame[row] : empty;
+            if (oldLine == newLine) continue;
+
+            if (oldLine.size() != newLine.size()) {
+                // Длина изменилась: хвост строки перерисовывается целиком
+                std::size_t first = 0;
+                std::size_t common = std::min(oldLine.size(), newLine.size());
+                while (first < common && oldLine[first] == newLine[first]) ++first;
+                while (first > 0 && first < newLine.size() && IsContinuation(newLine[first])) --first;
+                AppendSpan(out, row, newLine, first, newLine.size());
+                out += "\x1b[K";
+                continue;
+            }
+
+            // Длина та же: выводятся только отличающиеся ячейки; близкие
+            // отрезки склеиваются, если перевод курсора дороже общего текста
+            std::size_t pos = 0;
+            while (pos < newLine.size()) {
+                while (pos < newLine.size() && oldLine[pos] == newLine[pos]) ++pos;
+                if (pos == newLine.size()) break;
+                std::size_t first = pos;
+                std::size_t last = pos;
+                std::size_t equalRun = 0;
+                for (; pos < newLine.size() && equalRun <= kMergeGap; ++pos) {
+                    if (oldLine[pos] == newLine[pos]) {
+                        ++equalRun;
+                    } else {
+                        equalRun = 0;
+                        last = pos + 1;
+                    }
+                }
+                while (first > 0 && IsContinuation(newLine[first])) --first;
+                while (last < newLine.size() && IsContinuation(newLine[last])) ++last;
+                AppendSpan(out, row, newLine, first, last);
+                pos = last;
+            }
+        }
+        std::swap(_shown, _frame);
+    }
+
+public:
+    Dashboard(DeviceManager& manager, int fd = 1, std::size_t topCount = 5)
+        : _manager(manager), _fd(fd), _topCount(topCount) {
+        _manager.TrackTopByLoad(topCount);
+    }
+
+    // Дописывает в out обновление экрана; возвращает число добавленных байт
+    std::size_t RenderFrame(std::string& out) {
+        std::size_t before = out.size();
+        if (_hasFrame && _shownVersion == _manager.GetVersion() &&
+            _shownDemandVersion == _manager.GetDemandVersion()) {
+            return 0;
+        }
+        PROFILE_SCOPE("Dashboard::RenderFrame");
+        if (!_hasFrame) {
+            out += "\x1b[?25l\x1b[2J";
+            _shown.clear();
+        }
+        BuildFrame();
+        DiffInto(out);
+        out += "\x1b[";
+        AppendInt(out, static_cast<long long>(_shown.size() + 1));
+        out += ";1H";
+        _shownVersion = _manager.GetVersion();
+        _shownDemandVersion = _manager.GetDemandVersion();
+        _hasFrame = true;
+        return out.size() - before;
+    }
+
+    // Обновляет экран с частотой refreshHz; frames == 0 — без ограничения.
+    // tick вызывается перед каждым кадром (например, для симуляции нагрузки)
+    void Run(double refreshHz, std::size_t frames, const std::function<void()>& tick = {}) {
+        auto period = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double>(1.0 / refreshHz));
+        auto deadline = std::chrono::steady_clock::now();
+        std::string buffer;
+        for (std::size_t frame = 0; frames == 0 || frame < frames; ++frame) {
+            if (tick) tick();
+            _manager.SampleDemand();
+            buffer.clear();
+            if (RenderFrame(buffer) > 0) WriteAll(_fd, buffer.data(), buffer.size());
+            deadline += period;
+            std::this_thread::sleep_until(deadline);
+        }
+        const char restoreCursor[] = "\x1b[?25h";
+        WriteAll(_fd, restoreCursor, sizeof(restoreCursor) - 1);
+    }
+};
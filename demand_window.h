@@ -0,0 +1,189 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+// === Скользящее окно потребляемой мощности ===
+// Сетевые компании выставляют счёт по пиковой 15-минутной нагрузке. Окно
+// хранит выборки мощности; значение выборки действует до следующей.
+// Максимум в окне — голова монотонной очереди (значения в ней убывают),
+// среднее по времени — бегущая сумма «мощность × длительность» в Вт·мс
+// (целая, без накопления ошибки округления). Добавление и вытеснение —
+// O(1) амортизированно, запрос — O(1) в любой момент
+struct DemandStats {
+    long long current = 0;   // последняя выборка, Вт
+    long long peak = 0;      // наибольшая выборка в окне, Вт
+    double mean = 0;         // среднее по времени в окне, Вт
+    double peakMean = 0;     // наибольшее среднее по полному окну за всё время (расчётный пик), Вт
+    std::size_t samples = 0; // выборок в окне
+};
+
+class SlidingDemandWindow {
+private:
+    struct Sample {
+        std::int64_t atMs;
+        long long watts;
+    };
+    struct Candidate {
+        std::uint64_t sequence;
+        long long watts;
+    };
+
+    std::int64_t _windowMs;
+    // Выборки, чей интервал пересекается с окном. Изменяются и при чтении:
+    // вытеснение по текущему времени — часть запроса
+    mutable std::deque<Sample> _samples;
+    mutable std::deque<Candidate> _maxima;
+    mutable std::uint64_t _firstSequence = 0;
+    std::uint64_t _nextSequence = 0;
+    // Сумма watts × длительность по завершённым интервалам из _samples
+    mutable long long _areaWattMs = 0;
+    // Самое позднее время добавления или запроса: раньше него окно уже вытеснено
+    mutable std::int64_t _latestMs = 0;
+    double _peakMean = 0;
+
+    void Expire(std::int64_t nowMs) const {
+        std::int64_t cutoff = nowMs - _windowMs;
+        // Первая выборка остаётся, пока до начала окна не дошла следующая
+        while (_samples.size() >= 2 && _samples[1].atMs <= cutoff) {
+            _areaWattMs -= _samples[0].watts * (_samples[1].atMs - _samples[0].atMs);
+            _samples.pop_front();
+            ++_firstSequence;
+        }
+        while (!_maxima.empty() && _maxima.front().sequence < _firstSequence) _maxima.pop_front();
+    }
+
+    // Начало окна, покрытое выборками: не раньше первой из них
+    std::int64_t CoveredStart(std::int64_t nowMs) const {
+        std::int64_t firstMs = _samples.front().atMs;
+        return nowMs - _windowMs > firstMs ? nowMs - _windowMs : firstMs;
+    }
+
+    // Вт·мс от начала покрытой части окна до nowMs. Интервал первой
+    // выборки обрезается по началу окна, интервал последней тянется до
+    // текущего момента
+    long long AreaAt(std::int64_t nowMs) const {
+        const Sample& first = _samples.front();
+        const Sample& last = _samples.back();
+        return _areaWattMs - first.watts * (CoveredStart(nowMs) - first.atMs) + last.watts * (nowMs - last.atMs);
+    }
+
+    // Среднее по покрытой части окна; сразу после первой выборки — она сама
+    double MeanAt(std::int64_t nowMs) const {
+        std::int64_t covered = nowMs - CoveredStart(nowMs);
+        if (covered <= 0) return static_cast<double>(_samples.back().watts);
+        return static_cast<double>(AreaAt(nowMs)) / static_cast<double>(covered);
+    }
+
+    // Среднее по окну полной длины. Пока выборки не покрывают окно, время
+    // до первой из них считается нулевой нагрузкой: короткий всплеск после
+    // запуска не выдаётся за 15-минутный пик
+    double FullWindowMeanAt(std::int64_t nowMs) const {
+        return static_cast<double>(AreaAt(nowMs)) / static_cast<double>(_windowMs);
+    }
+
+public:
+    explicit SlidingDemandWindow(std::chrono::milliseconds window = std::chrono::minutes(15))
+        : _windowMs(window.count() > 0 ? window.count() : 1) {}
+
+    std::chrono::milliseconds Window() const { return std::chrono::milliseconds(_windowMs); }
+
+    // Время не убывает: выборка раньше последнего добавления или запроса
+    // сдвигается на его время
+    void Add(std::int64_t atMs, long long watts) {
+        if (atMs < _latestMs) atMs = _latestMs;
+        _latestMs = atMs;
+        if (!_samples.empty()) {
+            const Sample& last = _samples.back();
+            _areaWattMs += last.watts * (atMs - last.atMs);
+        }
+        _samples.push_back({atMs, watts});
+        while (!_maxima.empty() && _maxima.back().watts <= watts) _maxima.pop_back();
+        _maxima.push_back({_nextSequence++, watts});
+        Expire(atMs);
+        double mean = FullWindowMeanAt(atMs);
+        if (mean > _peakMean) _peakMean = mean;
+    }
+
+    DemandStats Read(std::int64_t nowMs) const {
+        DemandStats stats;
+        stats.peakMean = _peakMean;
+        if (_samples.empty()) return stats;
+        if (nowMs < _latestMs) nowMs = _latestMs;
+        _latestMs = nowMs;
+        Expire(nowMs);
+        stats.current = _samples.back().watts;
+        stats.peak = _maxima.front().watts;
+        stats.mean = MeanAt(nowMs);
+        stats.samples = _samples.size();
+        return stats;
+    }
+};
+
+// --- Окна по парку и по группам устройств ---
+// Выборки берутся не чаще раза в step: владелец менеджера вызывает
+// SampleDemand на каждом кадре или пакете команд, и частые вызовы не
+// раздувают окно
+class DemandTracker {
+private:
+    using Clock = std::chrono::steady_clock;
+
+    std::chrono::milliseconds _window;
+    std::chrono::milliseconds _step;
+    SlidingDemandWindow _site;
+    std::vector<SlidingDemandWindow> _groups;
+    Clock::time_point _origin = Clock::now();
+    std::int64_t _lastSampleMs = -1;
+    std::uint64_t _version = 0;
+
+public:
+    explicit DemandTracker(std::chrono::milliseconds window = std::chrono::minutes(15),
+                           std::chrono::milliseconds step = std::chrono::seconds(1))
+        : _window(window), _step(step), _site(window) {}
+
+    std::int64_t ToMs(Clock::time_point at) const {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(at - _origin).count();
+    }
+
+    // Меняет длину окна и шаг; накопленные выборки сбрасываются
+    void Configure(std::chrono::milliseconds window, std::chrono::milliseconds step) {
+        _window = window;
+        _step = step;
+        _site = SlidingDemandWindow(window);
+        _groups.clear();
+        _lastSampleMs = -1;
+        ++_version;
+    }
+
+    std::chrono::milliseconds Window() const { return _site.Window(); }
+
+    // Число выборок по парку и смен окна: меняется — окна стоит перечитать
+    std::uint64_t Version() const { return _version; }
+
+    // false — с прошлой выборки не прошёл шаг, вызывающему нечего добавлять
+    bool Due(Clock::time_point now) const {
+        return _lastSampleMs < 0 || ToMs(now) - _lastSampleMs >= _step.count();
+    }
+
+    // Выборка по парку; групповые добавляются следом через AddGroup
+    void AddSite(Clock::time_point now, long long watts) {
+        _lastSampleMs = ToMs(now);
+        _site.Add(_lastSampleMs, watts);
+        ++_version;
+    }
+
+    void AddGroup(std::size_t group, long long watts) {
+        // Новая группа начинает окно с текущей выборки
+        while (_groups.size() <= group) _groups.emplace_back(_window);
+        _groups[group].Add(_lastSampleMs, watts);
+    }
+
+    DemandStats Site(Clock::time_point now) const { return _site.Read(ToMs(now)); }
+
+    DemandStats Group(std::size_t group, Clock::time_point now) const {
+        return group < _groups.size() ? _groups[group].Read(ToMs(now)) : DemandStats{};
+    }
+};
@@ -0,0 +1,591 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "demand_window.h"
+#include "devices.h"
+#include "logger.h"
+#include "memory_accounting.h"
+#include "flat_name_map.h"
+#include "fleet_sketches.h"
+#include "latency_histogram.h"
+#include "name_index.h"
+#include "profiler.h"
+#include "roaring_bitmap.h"
+#include "shared_totals.h"
+#include "sharded_counter.h"
+#include "sorted_view.h"
+#include "trace.h"
+
+// --- Фильтр устройств для постраничного вывода ---
+// Пустые поля не участвуют в отборе; дешёвые проверки идут первыми
+struct DeviceFilter {
+    const char* typeName = nullptr;
+    std::string nameContains;
+    int onState = -1;  // -1 — любое, 0 — выключено, 1 — включено
+    int minPower = 0;
+
+    bool Matches(const AbstractElectricDevice& device) const {
+        if (onState >= 0 && device.IsOn() != (onState == 1)) return false;
+        if (minPower > 0 && device.GetPower() < minPower) return false;
+        if (typeName && std::strcmp(device.GetTypeName(), typeName) != 0) return false;
+        if (!nameContains.empty() && device.GetName().find(nameContains) == std::string::npos) return false;
+        return true;
+    }
+};
+
+// --- Страница списка устройств ---
+struct DevicePage {
+    std::vector<DeviceHandle> handles;
+    DeviceHandle nextCursor = 0;  // передаётся в следующий запрос страницы
+    bool hasMore = false;         // дальше есть ещё подходящие устройства
+};
+
+// --- Ключ упорядоченного представления ---
+enum class DeviceSortKey { RatedPower, Load, Name };
+
+// --- Нагрузка группы устройств (группа = тип устройства) ---
+struct DeviceGroupStats {
+    const char* name;
+    long long power = 0;
+    std::size_t count = 0;
+    std::size_t onCount = 0;
+};
+
+// === Класс логики приложения ===
+class DeviceManager {
+private:
+    std::vector<std::unique_ptr<AbstractElectricDevice>> _devices;
+    std::vector<std::uint16_t> _groupOf;
+
+    // Колонки атрибутов для поколоночных фильтров (см. filter_expression.h):
+    // номинальная и текущая мощность и номер производителя в словаре
+    std::vector<std::int32_t> _ratedPower;
+    std::vector<std::int32_t> _load;
+    std::vector<std::uint32_t> _brandOf;
+    std::deque<std::string> _brandNames;
+    FlatNameMap _brandIds;
+
+    // Модель — «производитель тип». Словарь моделей (по номерам
+    // производителя и группы) нужен скетчам: включение не строит строку и не
+    // считает хеш, а найти счётчик модели помогает сохранённый номер слота
+    struct ModelInfo {
+        std::uint64_t hash;
+        std::uint32_t modelsSlot = 0;
+        std::uint32_t switchOnsSlot = 0;
+    };
+    std::vector<std::uint32_t> _modelOf;
+    std::deque<std::string> _modelNames;
+    std::vector<ModelInfo> _models;
+    std::vector<std::vector<std::uint32_t>> _modelByBrand;  // [производитель][группа]
+    FleetSketches _sketches;
+    std::vector<DeviceGroupStats> _groups;
+    std::shared_ptr<ILogger> _logger;
+    NameIndex _nameIndex;
+
+    // Метки устройств: имя метки → битовое множество дескрипторов.
+    // Отдельно ведётся множество включённых устройств
+    std::deque<std::string> _tagNames;
+    FlatNameMap _tagIds;
+    std::vector<RoaringBitmap> _tagged;
+    // Включённые устройства — простая битовая строка: переключение не
+    // выделяет память, а RoaringBitmap строится из неё по запросу
+    std::vector<std::uint64_t> _onBits;
+
+    // Суммарная мощность поддерживается инкрементально, а версия растёт
+    // при каждом изменении: наблюдатели (панель мониторинга) по ней
+    // понимают, что пересчитывать нечего
+    long long _totalPower = 0;
+    std::size_t _onCount = 0;
+    std::uint64_t _version = 0;
+
+    // Представления кешируются по своим версиям: номинальная мощность и
+    // имена меняются только при добавлении, нагрузка — и при переключении
+    std::uint64_t _structureVersion = 0;
+    std::uint64_t _loadVersion = 0;
+    mutable SortedViewCache _byRatedPower;
+    mutable SortedViewCache _byLoad;
+    mutable SortedViewCache _byName;
+    // Первые по нагрузке для панели мониторинга; ведётся, только если задан TrackTopByLoad
+    mutable TopKeyTracker _topLoad;
+
+    // Скользящие окна нагрузки парка и групп; выборки добавляет SampleDemand
+    DemandTracker _demand;
+
+    // Сегмент разделяемой памяти для внешних читателей итогов (не владеет)
+    SharedTotalsPublisher* _sharedTotals = nullptr;
+
+    std::uint16_t GroupIndex(const char* typeName) {
+        for (std::size_t i = 0; i < _groups.size(); ++i) {
+            if (std::strcmp(_groups[i].name, typeName) == 0) return static_cast<std::uint16_t>(i);
+        }
+        _groups.push_back(DeviceGroupStats{typeName});
+        return static_cast<std::uint16_t>(_groups.size() - 1);
+    }
+
+    std::uint32_t ModelIndex(std::uint32_t brand, std::uint16_t group) {
+        std::vector<std::uint32_t>& byGroup = _modelByBrand[brand];
+        if (byGroup.size() <= group) byGroup.resize(group + 1, FlatNameMap::kNotFound);
+        if (byGroup[group] == FlatNameMap::kNotFound) {
+            MemoryTagScope names(MemoryTag::Names);
+            _modelNames.push_back(_brandNames[brand] + ' ' + _groups[group].name);
+            _models.push_back({FlatNameMap::Hash(_modelNames.back())});
+            byGroup[group] = static_cast<std::uint32_t>(_models.size() - 1);
+        }
+        return byGroup[group];
+    }
+
+    bool LogEnabled() const { return _logger->IsEnabled(LogLevel::Info); }
+
+    // Одна запись seqlock: итоги парка и изменившаяся группа
+    void PublishShared(std::size_t group, const char* name) {
+        const DeviceGroupStats& stats = _groups[group];
+        _sharedTotals->BeginWrite();
+        _sharedTotals->SetTotals(_totalPower, _devices.size(), _onCount, _version);
+        _sharedTotals->SetGroup(group, name, stats.power, stats.count, stats.onCount);
+        _sharedTotals->EndWrite();
+    }
+
+    // Применяет изменение состояния к счётчикам по разнице мощности до и после
+    template <typename Fn>
+    void Mutate(DeviceHandle index, Fn&& fn) {
+        auto& device = *_devices[index];
+        auto& group = _groups[_groupOf[index]];
+        int powerBefore = device.GetPower();
+        bool wasOn = device.IsOn();
+        fn(device);
+        long long delta = device.GetPower() - powerBefore;
+        _load[index] = device.GetPower();
+        if (delta != 0) {
+            ++_loadVersion;
+            _topLoad.Update(static_cast<std::uint32_t>(index), _load[index]);
+        }
+        _totalPower += delta;
+        group.power += delta;
+        if (wasOn != device.IsOn()) {
+            if (device.IsOn()) {
+                ++_onCount; ++group.onCount; _onBits[index / 64] |= std::uint64_t(1) << (index % 64);
+                OperationalStats::Get().devicesTurnedOn.Increment();
+                std::uint32_t model = _modelOf[index];
+                _sketches.switchOns.Add(_models[model].hash, _modelNames[model], 1, _models[model].switchOnsSlot);
+            } else {
+                --_onCount; --group.onCount; _onBits[index / 64] &= ~(std::uint64_t(1) << (index % 64));
+                OperationalStats::Get().devicesTurnedOff.Increment();
+            }
+        }
+        ++_version;
+        PROFILE_COUNT("DeviceManager.mutations", 1);
+        if (_sharedTotals) PublishShared(_groupOf[index], nullptr);
+    }
+
+    // Переключение одного устройства без замера задержки: в гистограмму
+    // попадает каждый публичный вызов целиком, в том числе TurnOnAll
+    void SwitchOn(DeviceHandle index) {
+        Mutate(index, [](AbstractElectricDevice& d) { d.TurnOn(); });
+        if (LogEnabled()) _logger->Log("Включено: " + _devices[index]->GetInfo());
+    }
+
+    void SwitchOff(DeviceHandle index) {
+        Mutate(index, [](AbstractElectricDevice& d) { d.TurnOff(); });
+        if (LogEnabled()) _logger->Log("Выключено: " + _devices[index]->GetInfo());
+    }
+
+    DeviceHandle Insert(std::unique_ptr<AbstractElectricDevice> device) {
+        MemoryTagScope memory(MemoryTag::Devices);
+        OperationalStats::Get().devicesAdded.Increment();
+        std::uint16_t group = GroupIndex(device->GetTypeName());
+        _groupOf.push_back(group);
+        _groups[group].count += 1;
+        // Устройство могло быть включено до добавления
+        if (device->IsOn()) {
+            _totalPower += device->GetPower();
+            _groups[group].power += device->GetPower();
+            ++_onCount;
+            ++_groups[group].onCount;
+        }
+        if (_devices.size() % 64 == 0) _onBits.push_back(0);
+        if (device->IsOn()) _onBits.back() |= std::uint64_t(1) << (_devices.size() % 64);
+        _nameIndex.Add(_devices.size(), device->GetName());
+        _ratedPower.push_back(device->GetRatedPower());
+        _load.push_back(device->GetPower());
+        _topLoad.Update(static_cast<std::uint32_t>(_devices.size()), _load.back());
+        std::uint32_t brand = _brandIds.Find(device->GetBrand());
+        if (brand == FlatNameMap::kNotFound) {
+            MemoryTagScope names(MemoryTag::Names);
+            _brandNames.push_back(device->GetBrand());
+            brand = _brandIds.Insert(_brandNames.back(), static_cast<std::uint32_t>(_brandNames.size() - 1));
+            // Повтор производителя не меняет HyperLogLog: хватает первого раза
+            _sketches.brands.Add(FlatNameMap::Hash(_brandNames.back()));
+            _modelByBrand.emplace_back();
+        }
+        _brandOf.push_back(brand);
+        std::uint32_t model = ModelIndex(brand, group);
+        _modelOf.push_back(model);
+        ModelInfo& info = _models[model];
+        _sketches.ratedPower.Add(device->GetRatedPower());
+        _sketches.models.Add(info.hash, _modelNames[model], 1, info.modelsSlot);
+        if (device->IsOn()) _sketches.switchOns.Add(info.hash, _modelNames[model], 1, info.switchOnsSlot);
+        _devices.push_back(std::move(device));
+        ++_version;
+        ++_structureVersion;
+        ++_loadVersion;
+        if (_sharedTotals) PublishShared(group, _groups[group].name);
+        return _devices.size() - 1;
+    }
+
+public:
+    DeviceManager(std::shared_ptr<ILogger> logger) : _logger(logger) {}
+
+    DeviceHandle AddDevice(std::unique_ptr<AbstractElectricDevice> device) {
+        PROFILE_SCOPE("DeviceManager::AddDevice");
+        TRACE_SPAN("DeviceManager::AddDevice");
+        LATENCY_SCOPE(LatencyOp::AddDevice);
+        if (LogEnabled()) _logger->Log("Добавлено устройство: " + device->GetInfo());
+        return Insert(std::move(device));
+    }
+
+    // Пакетное добавление count устройств одной фабрики с одной записью в лог;
+    // возвращает дескриптор первого из них
+    DeviceHandle AddDevices(const DeviceFactory& factory, std::size_t count) {
+        PROFILE_SCOPE("DeviceManager::AddDevices");
+        LATENCY_SCOPE(LatencyOp::AddDevice);
+        TRACE_SPAN_ARG("DeviceManager::AddDevices", "count", count);
+        DeviceHandle first = _devices.size();
+        Reserve(_devices.size() + count);
+        for (std::size_t i = 0; i < count; ++i) {
+            Insert(factory.Create());
+        }
+        if (count > 0 && LogEnabled()) {
+            _logger->Log("Добавлено устройств: " + std::to_string(count) + " (" +
+                         _devices[first]->GetTypeName() + ")");
+        }
+        return first;
+    }
+
+    // Пакетное добавление готовых устройств (например, от генератора парка)
+    DeviceHandle AddDevices(std::vector<std::unique_ptr<AbstractElectricDevice>> devices) {
+        PROFILE_SCOPE("DeviceManager::AddDevices");
+        LATENCY_SCOPE(LatencyOp::AddDevice);
+        TRACE_SPAN_ARG("DeviceManager::AddDevices", "count", devices.size());
+        DeviceHandle first = _devices.size();
+        Reserve(_devices.size() + devices.size());
+        for (auto& device : devices) {
+            Insert(std::move(device));
+        }
+        if (!devices.empty() && LogEnabled()) _logger->Log("Добавлено устройств: " + std::to_string(devices.size()));
+        return first;
+    }
+
+    void Reserve(std::size_t count) {
+        MemoryTagScope memory(MemoryTag::Devices);
+        _devices.reserve(count);
+        _groupOf.reserve(count);
+        _ratedPower.reserve(count);
+        _load.reserve(count);
+        _brandOf.reserve(count);
+        _modelOf.reserve(count);
+        _onBits.reserve((count + 63) / 64);
+    }
+
+    void TurnOn(DeviceHandle index) {
+        LATENCY_SCOPE(LatencyOp::TurnOn);
+        SwitchOn(index);
+    }
+
+    void TurnOff(DeviceHandle index) {
+        LATENCY_SCOPE(LatencyOp::TurnOff);
+        SwitchOff(index);
+    }
+
+    // Пакетное переключение: одна сводная запись в лог на весь пакет
+    void TurnOn(const std::vector<DeviceHandle>& handles) {
+        PROFILE_SCOPE("DeviceManager::TurnOn(batch)");
+        LATENCY_SCOPE(LatencyOp::TurnOn);
+        TRACE_SPAN_ARG("DeviceManager::TurnOn(batch)", "count", handles.size());
+        for (DeviceHandle handle : handles) {
+            Mutate(handle, [](AbstractElectricDevice& d) { d.TurnOn(); });
+        }
+        if (!handles.empty() && LogEnabled()) _logger->Log("Включено устройств: " + std::to_string(handles.size()));
+    }
+
+    void TurnOff(const std::vector<DeviceHandle>& handles) {
+        PROFILE_SCOPE("DeviceManager::TurnOff(batch)");
+        LATENCY_SCOPE(LatencyOp::TurnOff);
+        TRACE_SPAN_ARG("DeviceManager::TurnOff(batch)", "count", handles.size());
+        for (DeviceHandle handle : handles) {
+            Mutate(handle, [](AbstractElectricDevice& d) { d.TurnOff(); });
+        }
+        if (!handles.empty() && LogEnabled()) _logger->Log("Выключено устройств: " + std::to_string(handles.size()));
+    }
+
+    // Переключение выборки, полученной из меток (например, critical & floor3 - on)
+    void TurnOn(const RoaringBitmap& selection) {
+        PROFILE_SCOPE("DeviceManager::TurnOn(selection)");
+        LATENCY_SCOPE(LatencyOp::TurnOn);
+        TRACE_SPAN_ARG("DeviceManager::TurnOn(selection)", "count", selection.Cardinality());
+        selection.ForEach([this](std::uint32_t handle) {
+            Mutate(handle, [](AbstractElectricDevice& d) { d.TurnOn(); });
+        });
+        if (!selection.Empty() && LogEnabled()) _logger->Log("Включено устройств: " + std::to_string(selection.Cardinality()));
+    }
+
+    void TurnOff(const RoaringBitmap& selection) {
+        PROFILE_SCOPE("DeviceManager::TurnOff(selection)");
+        LATENCY_SCOPE(LatencyOp::TurnOff);
+        TRACE_SPAN_ARG("DeviceManager::TurnOff(selection)", "count", selection.Cardinality());
+        selection.ForEach([this](std::uint32_t handle) {
+            Mutate(handle, [](AbstractElectricDevice& d) { d.TurnOff(); });
+        });
+        if (!selection.Empty() && LogEnabled()) _logger->Log("Выключено устройств: " + std::to_string(selection.Cardinality()));
+    }
+
+    void TurnOnAll() {
+        PROFILE_SCOPE("DeviceManager::TurnOnAll");
+        LATENCY_SCOPE(LatencyOp::TurnOn);
+        TRACE_SPAN_ARG("DeviceManager::TurnOnAll", "count", _devices.size());
+        for (std::size_t i = 0; i < _devices.size(); ++i) {
+            SwitchOn(i);
+        }
+    }
+
+    void TurnOffAll() {
+        PROFILE_SCOPE("DeviceManager::TurnOffAll");
+        LATENCY_SCOPE(LatencyOp::TurnOff);
+        TRACE_SPAN_ARG("DeviceManager::TurnOffAll", "count", _devices.size());
+        for (std::size_t i = 0; i < _devices.size(); ++i) {
+            SwitchOff(i);
+        }
+    }
+
+    // Показание телеметрии: итоги парка, группы и колонка нагрузки
+    // обновляются на разницу с прошлым значением. false — нет такого устройства
+    bool SetMeasuredPower(DeviceHandle index, int watts) {
+        if (index >= _devices.size()) return false;
+        Mutate(index, [watts](AbstractElectricDevice& d) { d.SetMeasuredPower(watts); });
+        return true;
+    }
+
+    long long GetTotalPower() const {
+        LATENCY_SCOPE(LatencyOp::GetTotalPower);
+        return _totalPower;
+    }
+    std::size_t GetOnCount() const { return _onCount; }
+    std::uint64_t GetVersion() const { return _version; }
+    const std::vector<DeviceGroupStats>& GetGroups() const { return _groups; }
+
+    // --- Нагрузка во времени ---
+    // GetTotalPower — мгновенное значение; окна ниже помнят пик и среднее
+    // за последние Window() (по умолчанию 15 минут). Выборку берёт владелец
+    // менеджера — на кадре панели, после пакета команд; чаще шага (1 с)
+    // вызовы игнорируются
+    void SampleDemand(std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now()) {
+        if (_demand.Due(now)) RecordDemand(now);
+    }
+
+    // Выборка без учёта шага — перед явным запросом окон
+    void RecordDemand(std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now()) {
+        _demand.AddSite(now, _totalPower);
+        for (std::size_t group = 0; group < _groups.size(); ++group) _demand.AddGroup(group, _groups[group].power);
+    }
+
+    DemandStats GetSiteDemand(std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now()) const {
+        return _demand.Site(now);
+    }
+
+    DemandStats GetGroupDemand(std::size_t group,
+                               std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now()) const {
+        return _demand.Group(group, now);
+    }
+
+    std::chrono::milliseconds GetDemandWindow() const { return _demand.Window(); }
+
+    // Растёт с каждой выборкой окон и сменой окна — окна могли измениться
+    // и при неизменной GetVersion
+    std::uint64_t GetDemandVersion() const { return _demand.Version(); }
+
+    // Меняет окно и шаг выборки; накопленная история сбрасывается
+    void SetDemandWindow(std::chrono::milliseconds window, std::chrono::milliseconds step = std::chrono::seconds(1)) {
+        _demand.Configure(window, step);
+    }
+
+    // Возвращает до pageSize устройств, подходящих под фильтр, начиная
+    // с дескриптора cursor. Без фильтра просматриваются только устройства
+    // страницы; с редким совпадением поиск может дойти до конца парка.
+    // Курсор следующей страницы указывает на следующее совпадение, поэтому
+    // hasMore означает, что оно действительно есть
+    DevicePage ListPage(DeviceHandle cursor, std::size_t pageSize, const DeviceFilter& filter = {}) const {
+        DevicePage page;
+        if (cursor < _devices.size()) page.handles.reserve(std::min(pageSize, _devices.size() - cursor));
+        DeviceHandle handle = cursor;
+        for (; handle < _devices.size(); ++handle) {
+            if (!filter.Matches(*_devices[handle])) continue;
+            if (page.handles.size() == pageSize) break;
+            page.handles.push_back(handle);
+        }
+        page.nextCursor = handle;
+        page.hasMore = handle < _devices.size();
+        return page;
+    }
+
+    void Tag(DeviceHandle handle, std::string_view tag) {
+        MemoryTagScope memory(MemoryTag::Indexes);
+        std::uint32_t id = _tagIds.Find(tag);
+        if (id == FlatNameMap::kNotFound) {
+            {
+                MemoryTagScope names(MemoryTag::Names);
+                _tagNames.emplace_back(tag);
+                id = _tagIds.Insert(_tagNames.back(), static_cast<std::uint32_t>(_tagged.size()));
+            }
+            _tagged.emplace_back();
+        }
+        _tagged[id].Add(static_cast<std::uint32_t>(handle));
+        ++_version;
+    }
+
+    void Untag(DeviceHandle handle, std::string_view tag) {
+        MemoryTagScope memory(MemoryTag::Indexes);
+        std::uint32_t id = _tagIds.Find(tag);
+        if (id == FlatNameMap::kNotFound) return;
+        _tagged[id].Remove(static_cast<std::uint32_t>(handle));
+        ++_version;
+    }
+
+    // Устройства с меткой; nullptr, если метка не встречалась
+    const RoaringBitmap* GetTagged(std::string_view tag) const {
+        std::uint32_t id = _tagIds.Find(tag);
+        return id == FlatNameMap::kNotFound ? nullptr : &_tagged[id];
+    }
+
+    // Перестановка дескрипторов по возрастанию ключа. Мощности сортируются
+    // поразрядно, имена — раскладкой по уже отсортированным именам индекса
+    const std::vector<std::uint32_t>& GetSortedView(DeviceSortKey key) const {
+        MemoryTagScope memory(MemoryTag::Indexes);
+        switch (key) {
+            case DeviceSortKey::RatedPower:
+                if (!_byRatedPower.IsFresh(_structureVersion)) {
+                    RadixSortByKey(_ratedPower, _byRatedPower.order);
+                    _byRatedPower.MarkBuilt(_structureVersion);
+                }
+                return _byRatedPower.order;
+            case DeviceSortKey::Load:
+                if (!_byLoad.IsFresh(_loadVersion)) {
+                    RadixSortByKey(_load, _byLoad.order);
+                    _byLoad.MarkBuilt(_loadVersion);
+                }
+                return _byLoad.order;
+            case DeviceSortKey::Name:
+                if (!_byName.IsFresh(_structureVersion)) {
+                    _byName.order.clear();
+                    _byName.order.reserve(_devices.size());
+                    for (NameIndex::NameId id : _nameIndex.SortedNames()) {
+                        for (DeviceHandle handle : _nameIndex.Handles(id)) {
+                            _byName.order.push_back(static_cast<std::uint32_t>(handle));
+                        }
+                    }
+                    _byName.MarkBuilt(_structureVersion);
+                }
+                return _byName.order;
+        }
+        return _byName.order;
+    }
+
+    // Вести n самых нагруженных устройств инкрементально: TopByLoad до n
+    // перестаёт обходить парк на каждое изменение. 0 — перестать
+    void TrackTopByLoad(std::size_t n) { _topLoad.Track(n); }
+
+    // n самых нагруженных устройств; из отслеживаемых, если их хватает,
+    // иначе из свежего кеша или отбором по колонке
+    std::vector<std::uint32_t> TopByLoad(std::size_t n) const {
+        std::vector<std::uint32_t> top;
+        TopByLoad(n, top);
+        return top;
+    }
+
+    void TopByLoad(std::size_t n, std::vector<std::uint32_t>& top) const {
+        if (_topLoad.Covers(n)) return _topLoad.Top(_load, n, top);
+        if (!_byLoad.IsFresh(_loadVersion)) {
+            top = TopByKey(_load, n);
+            return;
+        }
+        const auto& order = _byLoad.order;
+        top.clear();
+        // Кеш по возрастанию и устойчив: равные нагрузки идут по возрастанию
+        // дескриптора, поэтому хвост обходится группами равных значений
+        std::size_t end = order.size();
+        while (end > 0 && top.size() < n) {
+            std::size_t begin = end - 1;
+            while (begin > 0 && _load[order[begin - 1]] == _load[order[end - 1]]) --begin;
+            for (std::size_t i = begin; i < end && top.size() < n; ++i) top.push_back(order[i]);
+            end = begin;
+        }
+    }
+
+    // --- Колонки атрибутов, по элементу на устройство ---
+    const std::vector<std::int32_t>& GetRatedPowerColumn() const { return _ratedPower; }
+    const std::vector<std::int32_t>& GetLoadColumn() const { return _load; }
+    const std::vector<std::uint16_t>& GetGroupColumn() const { return _groupOf; }
+    const std::vector<std::uint32_t>& GetBrandColumn() const { return _brandOf; }
+
+    // Номер производителя в словаре колонки; FlatNameMap::kNotFound, если такого нет
+    std::uint32_t FindBrand(std::string_view brand) const { return _brandIds.Find(brand); }
+    std::size_t GetBrandCount() const { return _brandNames.size(); }
+
+    // Номер группы (типа устройства); FlatNameMap::kNotFound, если такого нет
+    std::uint32_t FindGroup(std::string_view typeName) const {
+        for (std::size_t i = 0; i < _groups.size(); ++i) {
+            if (typeName == _groups[i].name) return static_cast<std::uint32_t>(i);
+        }
+        return FlatNameMap::kNotFound;
+    }
+
+    // Публиковать итоги в разделяемую память при каждом изменении;
+    // nullptr — перестать. Сегмент должен пережить менеджер или быть отключён
+    void PublishTotalsTo(SharedTotalsPublisher* publisher) {
+        _sharedTotals = publisher && publisher->IsOpen() ? publisher : nullptr;
+        if (!_sharedTotals) return;
+        for (std::size_t group = 0; group < _groups.size(); ++group) PublishShared(group, _groups[group].name);
+        if (_groups.empty()) {
+            _sharedTotals->BeginWrite();
+            _sharedTotals->SetTotals(_totalPower, _devices.size(), _onCount, _version);
+            _sharedTotals->EndWrite();
+        }
+    }
+
+    // Приближённые квантили мощности, число производителей и частые модели
+    // без обхода устройств. Скетчи разных менеджеров (шардов) сливаются
+    // через FleetSketches::Merge. Удаления устройств в менеджере нет, а
+    // выключение не вычитается: switchOns считает события включения
+    const FleetSketches& GetSketches() const { return _sketches; }
+
+    // Память по подсистемам (devices, names, logs, indexes) для всего
+    // процесса: живые байты и пик. Пусто, если учёт не входит в сборку
+    MemorySnapshot MemoryStats() const { return MemoryAccounting::Snapshot(); }
+
+    RoaringBitmap GetOnSet() const { return RoaringBitmap::FromWords(_onBits); }
+    RoaringBitmap GetAllSet() const { return RoaringBitmap::Range(static_cast<std::uint32_t>(_devices.size())); }
+
+    // Индекс имён для поиска по префиксу, подстроке и нечёткого поиска
+    const NameIndex& GetNameIndex() const { return _nameIndex; }
+
+    // Устройства с точно таким именем; пусто, если их нет.
+    // Диапазон действителен до следующего добавления устройства
+    NameIndex::HandleRange FindByName(std::string_view name) const { return _nameIndex.FindHandles(name); }
+
+    const AbstractElectricDevice& GetDevice(DeviceHandle handle) const { return *_devices[handle]; }
+    std::size_t GetDeviceCount() const { return _devices.size(); }
+
+    // Состояние устройств следует менять через TurnOn/TurnOff менеджера,
+    // иначе инкрементальные суммы разойдутся с устройствами
+    const std::vector<std::unique_ptr<AbstractElectricDevice>>& GetDevices() const {
+        return _devices;
+    }
+};
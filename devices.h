@@ -0,0 +1,172 @@
+#pragma once
+
+#include <charconv>
+#include <cstddef>
+#include <string>
+#include <memory>
+
+#include "alloc_tracker.h"
+#include "memory_accounting.h"
+
+// Дескриптор устройства — его позиция в менеджере. Устройства только
+// добавляются, поэтому дескриптор стабилен и годится как курсор страниц
+using DeviceHandle = std::size_t;
+
+// Дописывает десятичное число в конец строки без временных std::string
+inline void AppendInt(std::string& out, long long value) {
+    char buf[24];
+    auto res = std::to_chars(buf, buf + sizeof(buf), value);
+    out.append(buf, res.ptr);
+}
+
+// То же для беззнаковых: курсоры страниц занимают весь диапазон size_t
+inline void AppendUnsigned(std::string& out, unsigned long long value) {
+    char buf[24];
+    auto res = std::to_chars(buf, buf + sizeof(buf), value);
+    out.append(buf, res.ptr);
+}
+
+// === Абстрактный класс электроприбора ===
+class AbstractElectricDevice {
+protected:
+    std::string _name;
+    int _power;
+    bool _isOn;
+    int _measuredPower = -1;  // последнее показание телеметрии, -1 — показаний не было
+
+public:
+    AbstractElectricDevice(const std::string& name, int power)
+        : _name(name), _power(power), _isOn(false) {}
+
+    virtual void TurnOn() { _isOn = true; }
+    virtual void TurnOff() { _isOn = false; }
+    // Включённое устройство потребляет измеренную мощность, а пока
+    // показаний нет — паспортную
+    virtual int GetPower() const { return _isOn ? (_measuredPower >= 0 ? _measuredPower : _power) : 0; }
+
+    // Показание телеметрии в ваттах; отрицательное сбрасывает к паспортной мощности
+    void SetMeasuredPower(int watts) { _measuredPower = watts < 0 ? -1 : watts; }
+    int GetMeasuredPower() const { return _measuredPower; }
+    virtual const char* GetTypeName() const = 0;
+
+    // Производитель; у устройств без указанного производителя — пустая строка
+    virtual const std::string& GetBrand() const {
+        static const std::string noBrand;
+        return noBrand;
+    }
+
+    const std::string& GetName() const { return _name; }
+    int GetRatedPower() const { return _power; }
+    bool IsOn() const { return _isOn; }
+
+    // Описание дописывается в готовый буфер: так список из тысяч
+    // устройств собирается в одну строку без промежуточных копий
+    virtual void AppendInfo(std::string& out) const = 0;
+
+    virtual std::string GetInfo() const {
+        ALLOC_SITE("AbstractElectricDevice::GetInfo");
+        std::string info;
+        AppendInfo(info);
+        return info;
+    }
+
+    virtual ~AbstractElectricDevice() = default;
+};
+
+// --- Бытовая техника ---
+class HomeAppliance : public AbstractElectricDevice {
+protected:
+    std::string _brand;
+
+public:
+    HomeAppliance(const std::string& name, int power, const std::string& brand)
+        : AbstractElectricDevice(name, power), _brand(brand) {}
+
+    const std::string& GetBrand() const override { return _brand; }
+};
+
+// --- Электроинструмент ---
+class PowerTool : public AbstractElectricDevice {
+protected:
+    int _voltage;
+    std::string _brand;
+
+public:
+    PowerTool(const std::string& name, int power, int voltage, const std::string& brand = "")
+        : AbstractElectricDevice(name, power), _voltage(voltage), _brand(brand) {}
+
+    const std::string& GetBrand() const override { return _brand; }
+};
+
+// --- Холодильник ---
+class Refrigerator : public HomeAppliance {
+private:
+    int _capacity;
+
+public:
+    Refrigerator(const std::string& name, int power, const std::string& brand, int capacity)
+        : HomeAppliance(name, power, brand), _capacity(capacity) {}
+
+    const char* GetTypeName() const override { return "Refrigerator"; }
+
+    void AppendInfo(std::string& out) const override {
+        out += "Refrigerator: ";
+        out += _name;
+        out += ", Brand: ";
+        out += _brand;
+        out += ", Capacity: ";
+        AppendInt(out, _capacity);
+        out += "L, Power: ";
+        AppendInt(out, _power);
+        out += "W";
+    }
+};
+
+// --- Дрель ---
+class Drill : public PowerTool {
+private:
+    int _rpm;
+
+public:
+    Drill(const std::string& name, int power, int voltage, int rpm, const std::string& brand = "")
+        : PowerTool(name, power, voltage, brand), _rpm(rpm) {}
+
+    const char* GetTypeName() const override { return "Drill"; }
+
+    void AppendInfo(std::string& out) const override {
+        out += "Drill: ";
+        out += _name;
+        out += ", Voltage: ";
+        AppendInt(out, _voltage);
+        out += "V, RPM: ";
+        AppendInt(out, _rpm);
+        out += ", Power: ";
+        AppendInt(out, _power);
+        out += "W";
+    }
+};
+
+// === Интерфейс фабрики устройств ===
+class DeviceFactory {
+public:
+    virtual std::unique_ptr<AbstractElectricDevice> Create() const = 0;
+    virtual ~DeviceFactory() = default;
+};
+
+// --- Фабрика холодильников ---
+class RefrigeratorFactory : public DeviceFactory {
+public:
+    std::unique_ptr<AbstractElectricDevice> Create() const override {
+        MemoryTagScope memory(MemoryTag::Devices);
+        return std::make_unique<Refrigerator>("Samsung Fridge", 150, "Samsung", 300);
+    }
+};
+
+// --- Фабрика дрелей ---
+class DrillFactory : public DeviceFactory {
+public:
+    std::unique_ptr<AbstractElectricDevice> Create() const override {
+        MemoryTagScope memory(MemoryTag::Devices);
+        return std::make_unique<Drill>("Bosch Drill", 800, 220, 3000, "Bosch");
+    }
+};
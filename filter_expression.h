@@ -0,0 +1,343 @@
+#pragma once
+
+#include <cctype>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "device_manager.h"
+#include "roaring_bitmap.h"
+
+// === Выражение-фильтр над устройствами ===
+// Пример: power > 500 && type == Drill && brand == "Bosch" && !on
+//
+//   выражение := и ('||' и)*
+//   и         := унарное ('&&' унарное)*
+//   унарное   := '!' унарное | '(' выражение ')' | on | сравнение
+//   сравнение := поле оп значение
+//
+// Поля: power (номинальная мощность), load (текущая мощность) — числа,
+// операции == != < <= > >=; type, brand, name — строки, операции == !=;
+// on — признак включения. Выражение компилируется один раз в план;
+// план вычисляется по колонкам DeviceManager: каждое сравнение — один
+// проход по колонке, дающий битовую карту, которые затем объединяются
+// как RoaringBitmap. Цепочка одинаковых && или || — один узел с любым
+// числом операндов; вложенность скобок и ! ограничена kMaxDepth: разбор
+// и вычисление рекурсивны, и слишком глубокое выражение — ошибка разбора,
+// а не переполнение стека
+class FilterExpression {
+public:
+    static constexpr std::size_t kMaxDepth = 256;
+
+private:
+    enum class Field { Power, Load, Type, Brand, Name, On };
+    enum class Cmp { Eq, Ne, Lt, Le, Gt, Ge };
+    enum class Kind { Compare, And, Or, Not };
+
+    // Узел плана. Операнд Not — индекс в _nodes; операнды And/Or —
+    // _operands[first, first + count), сами индексы в _nodes
+    struct Node {
+        Kind kind = Kind::Compare;
+        Field field = Field::On;
+        Cmp cmp = Cmp::Eq;
+        long long number = 0;
+        std::string text{};
+        std::size_t first = 0;
+        std::size_t count = 0;
+    };
+
+    enum class Token { End, Ident, Number, String, Op, LParen, RParen, Error };
+
+    std::vector<Node> _nodes;
+    std::vector<std::size_t> _operands;
+    std::size_t _root = 0;
+
+    // --- Разбор ---
+    std::string_view _source;
+    std::size_t _pos = 0;
+    Token _token = Token::End;
+    std::string_view _lexeme;
+    std::string _error;
+    std::size_t _depth = 0;  // текущая глубина рекурсии разбора
+
+    void Next() {
+        while (_pos < _source.size() && std::isspace(static_cast<unsigned char>(_source[_pos]))) ++_pos;
+        std::size_t start = _pos;
+        if (_pos >= _source.size()) {
+            _token = Token::End;
+            _lexeme = {};
+            return;
+        }
+        char c = _source[_pos];
+        if (std::isalpha(static_cast<unsigned char>(c)) || c == '_') {
+            while (_pos < _source.size() &&
+                   (std::isalnum(static_cast<unsigned char>(_source[_pos])) || _source[_pos] == '_')) ++_pos;
+            _token = Token::Ident;
+        } else if (std::isdigit(static_cast<unsigned char>(c)) ||
+                   (c == '-' && _pos + 1 < _source.size() &&
+                    std::isdigit(static_cast<unsigned char>(_source[_pos + 1])))) {
+            ++_pos;
+            while (_pos < _source.size() && std::isdigit(static_cast<unsigned char>(_source[_pos]))) ++_pos;
+            _token = Token::Number;
+        } else if (c == '"') {
+            std::size_t end = _source.find('"', _pos + 1);
+            if (end == std::string_view::npos) {
+                _token = Token::Error;
+                _error = "unterminated string";
+                return;
+            }
+            _lexeme = _source.substr(_pos + 1, end - _pos - 1);
+            _pos = end + 1;
+            _token = Token::String;
+            return;
+        } else if (c == '(' || c == ')') {
+            ++_pos;
+            _token = c == '(' ? Token::LParen : Token::RParen;
+        } else {
+            static const char* const kOps[] = {"->", "&&", "||", "==", "!=", "<=", ">=", "<", ">", "!"};
+            _token = Token::Error;
+            for (const char* op : kOps) {
+                std::string_view candidate(op);
+                if (_source.substr(_pos, candidate.size()) == candidate) {
+                    _pos += candidate.size();
+                    _token = Token::Op;
+                    break;
+                }
+            }
+            if (_token == Token::Error) _error = "unexpected character";
+        }
+        _lexeme = _source.substr(start, _pos - start);
+    }
+
+    bool Fail(const char* message) {
+        if (_error.empty()) _error = message;
+        return false;
+    }
+
+    bool Add(Node node, std::size_t& out) {
+        _nodes.push_back(std::move(node));
+        out = _nodes.size() - 1;
+        return true;
+    }
+
+    // Операнды одной цепочки собираются локально: вложенные цепочки
+    // дописывают свои в _operands раньше, чем эта закончится
+    bool AddChain(Kind kind, const std::vector<std::size_t>& operands, std::size_t& out) {
+        if (operands.size() == 1) {
+            out = operands[0];
+            return true;
+        }
+        Node node{kind};
+        node.first = _operands.size();
+        node.count = operands.size();
+        _operands.insert(_operands.end(), operands.begin(), operands.end());
+        return Add(std::move(node), out);
+    }
+
+    bool ParseOr(std::size_t& out) {
+        std::vector<std::size_t> operands(1);
+        if (!ParseAnd(operands[0])) return false;
+        while (_token == Token::Op && _lexeme == "||") {
+            Next();
+            operands.push_back(0);
+            if (!ParseAnd(operands.back())) return false;
+        }
+        return AddChain(Kind::Or, operands, out);
+    }
+
+    bool ParseAnd(std::size_t& out) {
+        std::vector<std::size_t> operands(1);
+        if (!ParseUnary(operands[0])) return false;
+        while (_token == Token::Op && _lexeme == "&&") {
+            Next();
+            operands.push_back(0);
+            if (!ParseUnary(operands.back())) return false;
+        }
+        return AddChain(Kind::And, operands, out);
+    }
+
+    bool ParseUnary(std::size_t& out) {
+        if (_token == Token::Op && _lexeme == "!") {
+            if (++_depth > kMaxDepth) return Fail("expression nested too deeply");
+            Next();
+            std::size_t operand = 0;
+            if (!ParseUnary(operand)) return false;
+            --_depth;
+            Node node{Kind::Not};
+            node.first = operand;
+            return Add(std::move(node), out);
+        }
+        if (_token == Token::LParen) {
+            if (++_depth > kMaxDepth) return Fail("expression nested too deeply");
+            Next();
+            if (!ParseOr(out)) return false;
+            if (_token != Token::RParen) return Fail("expected ')'");
+            --_depth;
+            Next();
+            return true;
+        }
+        return ParseComparison(out);
+    }
+
+    bool ParseComparison(std::size_t& out) {
+        if (_token != Token::Ident) return Fail("expected field name");
+        Node node{Kind::Compare};
+        if (_lexeme == "power") node.field = Field::Power;
+        else if (_lexeme == "load") node.field = Field::Load;
+        else if (_lexeme == "type") node.field = Field::Type;
+        else if (_lexeme == "brand") node.field = Field::Brand;
+        else if (_lexeme == "name") node.field = Field::Name;
+        else if (_lexeme == "on") node.field = Field::On;
+        else return Fail("unknown field");
+        Next();
+
+        if (node.field == Field::On) return Add(std::move(node), out);
+
+        if (_token != Token::Op) return Fail("expected comparison operator");
+        if (_lexeme == "==") node.cmp = Cmp::Eq;
+        else if (_lexeme == "!=") node.cmp = Cmp::Ne;
+        else if (_lexeme == "<") node.cmp = Cmp::Lt;
+        else if (_lexeme == "<=") node.cmp = Cmp::Le;
+        else if (_lexeme == ">") node.cmp = Cmp::Gt;
+        else if (_lexeme == ">=") node.cmp = Cmp::Ge;
+        else return Fail("expected comparison operator");
+        Next();
+
+        bool numeric = node.field == Field::Power || node.field == Field::Load;
+        if (numeric) {
+            auto res = std::from_chars(_lexeme.data(), _lexeme.data() + _lexeme.size(), node.number);
+            if (_token != Token::Number || res.ec != std::errc() || res.ptr != _lexeme.data() + _lexeme.size()) {
+                return Fail("expected number");
+            }
+        } else {
+            if (node.cmp != Cmp::Eq && node.cmp != Cmp::Ne) return Fail("strings support only == and !=");
+            if (_token != Token::Ident && _token != Token::String) return Fail("expected string");
+            node.text.assign(_lexeme.data(), _lexeme.size());
+        }
+        Next();
+        return Add(std::move(node), out);
+    }
+
+    // --- Вычисление ---
+
+    // Один проход по колонке: бит i результата — pred(column[i])
+    template <typename T, typename Pred>
+    static RoaringBitmap ScanColumn(const std::vector<T>& column, Pred pred) {
+        std::size_t count = column.size();
+        std::vector<std::uint64_t> words((count + 63) / 64, 0);
+        std::size_t full = count / 64;
+        const T* data = column.data();
+        for (std::size_t w = 0; w < full; ++w) {
+            std::uint64_t word = 0;
+            const T* block = data + w * 64;
+            for (unsigned bit = 0; bit < 64; ++bit) {
+                word |= std::uint64_t(pred(block[bit])) << bit;
+            }
+            words[w] = word;
+        }
+        for (std::size_t i = full * 64; i < count; ++i) {
+            words[i / 64] |= std::uint64_t(pred(data[i])) << (i % 64);
+        }
+        return RoaringBitmap::FromWords(words);
+    }
+
+    static RoaringBitmap ScanNumber(const std::vector<std::int32_t>& column, Cmp cmp, long long value) {
+        switch (cmp) {
+            case Cmp::Eq: return ScanColumn(column, [value](std::int32_t x) { return x == value; });
+            case Cmp::Ne: return ScanColumn(column, [value](std::int32_t x) { return x != value; });
+            case Cmp::Lt: return ScanColumn(column, [value](std::int32_t x) { return x < value; });
+            case Cmp::Le: return ScanColumn(column, [value](std::int32_t x) { return x <= value; });
+            case Cmp::Gt: return ScanColumn(column, [value](std::int32_t x) { return x > value; });
+            case Cmp::Ge: return ScanColumn(column, [value](std::int32_t x) { return x >= value; });
+        }
+        return RoaringBitmap();
+    }
+
+    RoaringBitmap EvaluateCompare(const Node& node, const DeviceManager& manager) const {
+        switch (node.field) {
+            case Field::Power: return ScanNumber(manager.GetRatedPowerColumn(), node.cmp, node.number);
+            case Field::Load: return ScanNumber(manager.GetLoadColumn(), node.cmp, node.number);
+            case Field::On: return manager.GetOnSet();
+            case Field::Type:
+            case Field::Brand: {
+                // Строка переводится в номер словаря один раз на вычисление
+                std::uint32_t id = node.field == Field::Type ? manager.FindGroup(node.text)
+                                                              : manager.FindBrand(node.text);
+                RoaringBitmap equal;
+                if (id != FlatNameMap::kNotFound && node.field == Field::Type) {
+                    auto group = static_cast<std::uint16_t>(id);
+                    equal = ScanColumn(manager.GetGroupColumn(), [group](std::uint16_t x) { return x == group; });
+                } else if (id != FlatNameMap::kNotFound) {
+                    equal = ScanColumn(manager.GetBrandColumn(), [id](std::uint32_t x) { return x == id; });
+                }
+                return node.cmp == Cmp::Eq ? equal : manager.GetAllSet() - equal;
+            }
+            case Field::Name: {
+                // Имена уже проиндексированы: берём готовый список устройств
+                RoaringBitmap equal;
+                for (DeviceHandle handle : manager.FindByName(node.text)) equal.Add(static_cast<std::uint32_t>(handle));
+                return node.cmp == Cmp::Eq ? equal : manager.GetAllSet() - equal;
+            }
+        }
+        return RoaringBitmap();
+    }
+
+    RoaringBitmap EvaluateNode(std::size_t index, const DeviceManager& manager) const {
+        const Node& node = _nodes[index];
+        switch (node.kind) {
+            case Kind::Compare: return EvaluateCompare(node, manager);
+            case Kind::And:
+            case Kind::Or: {
+                RoaringBitmap result = EvaluateNode(_operands[node.first], manager);
+                for (std::size_t i = 1; i < node.count; ++i) {
+                    RoaringBitmap operand = EvaluateNode(_operands[node.first + i], manager);
+                    result = node.kind == Kind::And ? result & operand : result | operand;
+                }
+                return result;
+            }
+            case Kind::Not: return manager.GetAllSet() - EvaluateNode(node.first, manager);
+        }
+        return RoaringBitmap();
+    }
+
+public:
+    // Компилирует выражение; при ошибке возвращает false и описание в error.
+    // С action разбор останавливается на «->» вне строковых литералов,
+    // а в action попадает текст после стрелки (пусто, если стрелки нет)
+    bool Compile(std::string_view text, std::string& error, std::string_view* action = nullptr) {
+        _nodes.clear();
+        _operands.clear();
+        _source = text;
+        _pos = 0;
+        _depth = 0;
+        _error.clear();
+        if (action) *action = {};
+        Next();
+        bool ok = _token != Token::Error && ParseOr(_root);
+        if (ok && action && _token == Token::Op && _lexeme == "->") {
+            *action = _source.substr(_pos);
+            _token = Token::End;
+        }
+        if (ok && _token != Token::End) ok = Fail("unexpected trailing input");
+        if (!ok) {
+            error = _error.empty() ? "syntax error" : _error;
+            error += " at position ";
+            error += std::to_string(_pos);
+            _nodes.clear();
+            _operands.clear();
+        }
+        _source = {};
+        return ok;
+    }
+
+    bool IsCompiled() const { return !_nodes.empty(); }
+
+    // Множество подходящих устройств
+    RoaringBitmap Evaluate(const DeviceManager& manager) const {
+        if (_nodes.empty()) return RoaringBitmap();
+        return EvaluateNode(_root, manager);
+    }
+};
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <vector>
+
+// === Плоская хеш-таблица «строка → число» с открытой адресацией ===
+// Все слоты лежат в одном массиве, линейное пробирование. Слот занимает
+// одну строку кеша: в нём полный хеш, первые kInlineKeyBytes байт ключа и
+// число вызывающего (payload), так что поиск ключа не длиннее
+// kInlineKeyBytes вместе с payload не выходит за строку найденного слота.
+// Поиск идёт по std::string_view без создания временных std::string.
+// Таблица не владеет ключами: строки должен хранить вызывающий
+// (например, NameIndex держит их в deque, который не перемещает строки)
+class FlatNameMap {
+public:
+    static constexpr std::uint32_t kNotFound = UINT32_MAX;
+    static constexpr std::size_t kInlineKeyBytes = 32;
+
+    static std::uint64_t Hash(std::string_view key) {
+        // FNV-1a с финальным перемешиванием, чтобы младшие биты зависели от всех байт
+        std::uint64_t h = 14695981039346656037ull;
+        for (char c : key) {
+            h ^= static_cast<unsigned char>(c);
+            h *= 1099511628211ull;
+        }
+        h ^= h >> 32;
+        h *= 0xd6e8feb86659fd93ull;
+        h ^= h >> 32;
+        return h;
+    }
+
+private:
+    struct alignas(64) Slot {
+        std::uint64_t hash;
+        const char* key;
+        std::uint32_t length;
+        std::uint32_t value;  // kNotFound — пустой слот
+        std::size_t payload;
+        char inlineKey[kInlineKeyBytes];  // начало ключа, дополненное нулями
+    };
+
+    std::vector<Slot> _slots;
+    std::size_t _size = 0;
+    std::size_t _mask = 0;
+
+    // Хвост длинного ключа — единственное обращение за пределы слота
+    static bool Matches(const Slot& slot, std::uint64_t hash, std::string_view key) {
+        if (slot.hash != hash || slot.length != key.size()) return false;
+        std::size_t head = key.size() < kInlineKeyBytes ? key.size() : kInlineKeyBytes;
+        if (std::memcmp(slot.inlineKey, key.data(), head) != 0) return false;
+        return head == key.size() || std::memcmp(slot.key + head, key.data() + head, key.size() - head) == 0;
+    }
+
+    const Slot* FindSlot(std::string_view key) const {
+        std::uint64_t hash = Hash(key);
+        for (std::size_t i = hash & _mask;; i = (i + 1) & _mask) {
+            const Slot& slot = _slots[i];
+            if (slot.value == kNotFound) return nullptr;
+            if (Matches(slot, hash, key)) return &slot;
+        }
+    }
+
+    void Rehash(std::size_t capacity) {
+        std::vector<Slot> old;
+        old.swap(_slots);
+        _slots.assign(capacity, Slot{0, nullptr, 0, kNotFound, 0, {}});
+        _mask = capacity - 1;
+        for (const Slot& slot : old) {
+            if (slot.value == kNotFound) continue;
+            std::size_t i = slot.hash & _mask;
+            while (_slots[i].value != kNotFound) i = (i + 1) & _mask;
+            _slots[i] = slot;
+        }
+    }
+
+public:
+    FlatNameMap() { Rehash(16); }
+
+    std::size_t Size() const { return _size; }
+
+    void Reserve(std::size_t count) {
+        std::size_t capacity = _slots.size();
+        while (count * 4 > capacity * 3) capacity *= 2;
+        if (capacity != _slots.size()) Rehash(capacity);
+    }
+
+    std::uint32_t Find(std::string_view key) const {
+        const Slot* slot = FindSlot(key);
+        return slot ? slot->value : kNotFound;
+    }
+
+    // То же и указатель на payload ключа (nullptr, если ключа нет).
+    // Указатель действителен до следующего Insert
+    std::uint32_t Find(std::string_view key, const std::size_t*& payload) const {
+        const Slot* slot = FindSlot(key);
+        payload = slot ? &slot->payload : nullptr;
+        return slot ? slot->value : kNotFound;
+    }
+
+    std::uint32_t Find(std::string_view key, std::size_t*& payload) {
+        Slot* slot = const_cast<Slot*>(FindSlot(key));
+        payload = slot ? &slot->payload : nullptr;
+        return slot ? slot->value : kNotFound;
+    }
+
+    // Добавляет ключ, если его ещё нет; возвращает значение из таблицы
+    std::uint32_t Insert(std::string_view key, std::uint32_t value, std::size_t payload = 0) {
+        Reserve(_size + 1);
+        std::uint64_t hash = Hash(key);
+        std::size_t i = hash & _mask;
+        for (;; i = (i + 1) & _mask) {
+            const Slot& slot = _slots[i];
+            if (slot.value == kNotFound) break;
+            if (Matches(slot, hash, key)) return slot.value;
+        }
+        Slot& slot = _slots[i];
+        slot = Slot{hash, key.data(), static_cast<std::uint32_t>(key.size()), value, payload, {}};
+        std::memcpy(slot.inlineKey, key.data(), key.size() < kInlineKeyBytes ? key.size() : kInlineKeyBytes);
+        ++_size;
+        return value;
+    }
+};
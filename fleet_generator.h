@@ -0,0 +1,243 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "device_manager.h"
+#include "devices.h"
+#include "memory_accounting.h"
+
+// --- Параметры синтетического парка ---
+struct FleetSpec {
+    std::size_t count = 1000;
+    std::uint64_t seed = 1;
+    unsigned threads = 0;  // 0 — по числу ядер
+
+    // Доля дрелей, остальное — холодильники
+    double drillShare = 0.5;
+
+    // Производители выбираются по закону Ципфа: i-й с весом 1 / (i + 1)^zipf
+    std::vector<std::string> brands = {"Bosch", "Samsung", "LG", "Makita", "Atlant", "Bork", "Indesit", "DeWalt"};
+    double brandZipf = 1.1;
+
+    // Мощность — нормальное распределение, обрезанное снизу до 1 Вт
+    double fridgePowerMean = 150, fridgePowerStddev = 40;
+    double drillPowerMean = 800, drillPowerStddev = 200;
+
+    // Доля устройств, включённых изначально
+    double onRatio = 0.3;
+};
+
+// === Генератор синтетических парков устройств ===
+// Каждое устройство i строится из собственного потока случайных чисел,
+// выведенного из (seed, i), поэтому результат не зависит от числа потоков
+// и от того, куда он пишется: в DeviceManager или в файл снимка
+class FleetGenerator {
+public:
+    // Описание одного устройства; из него строится объект или строка снимка
+    struct DeviceRecord {
+        bool drill;
+        bool on;
+        std::uint16_t brand;
+        std::uint16_t model;
+        int power;
+        int capacity;  // холодильник, л
+        int voltage;   // дрель, В
+        int rpm;       // дрель, об/мин
+    };
+
+private:
+    FleetSpec _spec;
+    std::vector<double> _brandCdf;
+
+    // Поток SplitMix64: быстрый, с хорошим перемешиванием, без состояния сверх 64 бит
+    struct Random {
+        std::uint64_t state;
+
+        std::uint64_t Next() {
+            return Mix(state += 0x9E3779B97F4A7C15ull);
+        }
+
+        // Финальное перемешивание SplitMix64: разводит потоки соседних номеров
+        static std::uint64_t Mix(std::uint64_t z) {
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+            return z ^ (z >> 31);
+        }
+
+        double Uniform() { return static_cast<double>(Next() >> 11) * (1.0 / 9007199254740992.0); }
+
+        double Normal(double mean, double stddev) {
+            double u1 = std::max(Uniform(), 1e-300);
+            double u2 = Uniform();
+            return mean + stddev * std::sqrt(-2.0 * std::log(u1)) * std::cos(6.283185307179586 * u2);
+        }
+    };
+
+    std::unique_ptr<AbstractElectricDevice> Build(const DeviceRecord& record) const {
+        MemoryTagScope memory(MemoryTag::Devices);
+        std::string name = _spec.brands[record.brand];
+        name += record.drill ? " Drill " : " Fridge ";
+        AppendInt(name, record.model);
+        std::unique_ptr<AbstractElectricDevice> device;
+        if (record.drill) {
+            device = std::make_unique<Drill>(name, record.power, record.voltage, record.rpm,
+                                             _spec.brands[record.brand]);
+        } else {
+            device = std::make_unique<Refrigerator>(name, record.power, _spec.brands[record.brand],
+                                                    record.capacity);
+        }
+        if (record.on) device->TurnOn();
+        return device;
+    }
+
+    // Разбивает [0, count) на куски по потокам (не мельче grain) и вызывает fn(first, last) в каждом
+    template <typename Fn>
+    void ParallelFor(std::size_t count, std::size_t grain, Fn&& fn) const {
+        unsigned threads = _spec.threads ? _spec.threads : std::max(1u, std::thread::hardware_concurrency());
+        threads = static_cast<unsigned>(std::min<std::size_t>(threads, std::max<std::size_t>(1, count / grain)));
+        if (threads <= 1) {
+            fn(std::size_t(0), count);
+            return;
+        }
+        std::vector<std::thread> workers;
+        std::size_t chunk = (count + threads - 1) / threads;
+        for (unsigned t = 0; t < threads; ++t) {
+            std::size_t first = t * chunk;
+            std::size_t last = std::min(count, first + chunk);
+            if (first >= last) break;
+            workers.emplace_back([&fn, first, last] { fn(first, last); });
+        }
+        for (auto& worker : workers) worker.join();
+    }
+
+public:
+    FleetGenerator(FleetSpec spec) : _spec(std::move(spec)) {
+        if (_spec.brands.empty()) _spec.brands.push_back("Generic");
+        double total = 0;
+        for (std::size_t i = 0; i < _spec.brands.size(); ++i) {
+            total += 1.0 / std::pow(static_cast<double>(i + 1), _spec.brandZipf);
+            _brandCdf.push_back(total);
+        }
+        for (double& edge : _brandCdf) edge /= total;
+    }
+
+    const FleetSpec& Spec() const { return _spec; }
+
+    // Описание устройства с номером index; зависит только от seed и index
+    DeviceRecord Generate(std::size_t index) const {
+        Random random{Random::Mix(_spec.seed ^ Random::Mix(index + 0x9E3779B97F4A7C15ull))};
+        DeviceRecord record{};
+        record.drill = random.Uniform() < _spec.drillShare;
+        std::size_t brand = static_cast<std::size_t>(
+            std::upper_bound(_brandCdf.begin(), _brandCdf.end(), random.Uniform()) - _brandCdf.begin());
+        record.brand = static_cast<std::uint16_t>(std::min(brand, _spec.brands.size() - 1));
+        record.model = static_cast<std::uint16_t>(100 + random.Next() % 900);
+        double power = record.drill ? random.Normal(_spec.drillPowerMean, _spec.drillPowerStddev)
+                                    : random.Normal(_spec.fridgePowerMean, _spec.fridgePowerStddev);
+        record.power = std::max(1, static_cast<int>(std::lround(power)));
+        record.capacity = 150 + static_cast<int>(random.Next() % 8) * 50;
+        record.voltage = random.Next() % 4 == 0 ? 18 : 220;
+        record.rpm = 1500 + static_cast<int>(random.Next() % 8) * 250;
+        record.on = random.Uniform() < _spec.onRatio;
+        return record;
+    }
+
+    // Строит устройства параллельно и добавляет их в менеджер одним пакетом;
+    // возвращает дескриптор первого
+    DeviceHandle Populate(DeviceManager& manager) const {
+        std::vector<std::unique_ptr<AbstractElectricDevice>> devices(_spec.count);
+        ParallelFor(_spec.count, 4096, [&](std::size_t first, std::size_t last) {
+            for (std::size_t i = first; i < last; ++i) devices[i] = Build(Generate(i));
+        });
+        return manager.AddDevices(std::move(devices));
+    }
+
+    // Пишет парк в текстовый снимок: строка заголовка и по строке на устройство
+    //   drill|fridge;бренд;модель;мощность;ёмкость;напряжение;обороты;вкл
+    // Куски форматируются параллельно и пишутся по порядку
+    bool WriteSnapshot(const char* path) const {
+        std::FILE* out = std::fopen(path, "wb");
+        if (!out) return false;
+        std::fputs("# type;brand;model;power;capacity;voltage;rpm;on\n", out);
+
+        constexpr std::size_t kBlock = 1 << 16;
+        bool ok = true;
+        for (std::size_t base = 0; base < _spec.count && ok; base += kBlock * 16) {
+            std::size_t blocks = std::min<std::size_t>(16, (_spec.count - base + kBlock - 1) / kBlock);
+            std::vector<std::string> texts(blocks);
+            ParallelFor(blocks, 1, [&](std::size_t first, std::size_t last) {
+                for (std::size_t b = first; b < last; ++b) {
+                    std::string& text = texts[b];
+                    std::size_t end = std::min(_spec.count, base + (b + 1) * kBlock);
+                    for (std::size_t i = base + b * kBlock; i < end; ++i) AppendRecord(text, Generate(i));
+                }
+            });
+            for (const std::string& text : texts) {
+                ok = ok && std::fwrite(text.data(), 1, text.size(), out) == text.size();
+            }
+        }
+        return std::fclose(out) == 0 && ok;
+    }
+
+    void AppendRecord(std::string& out, const DeviceRecord& record) const {
+        out += record.drill ? "drill;" : "fridge;";
+        out += _spec.brands[record.brand];
+        out += ';';
+        AppendInt(out, record.model);
+        out += ';';
+        AppendInt(out, record.power);
+        out += ';';
+        AppendInt(out, record.capacity);
+        out += ';';
+        AppendInt(out, record.voltage);
+        out += ';';
+        AppendInt(out, record.rpm);
+        out += record.on ? ";1\n" : ";0\n";
+    }
+
+    // Загружает снимок в менеджер; возвращает число устройств или -1 при ошибке
+    static long long LoadSnapshot(const char* path, DeviceManager& manager) {
+        std::FILE* in = std::fopen(path, "rb");
+        if (!in) return -1;
+        std::vector<std::unique_ptr<AbstractElectricDevice>> devices;
+        char line[512];
+        while (std::fgets(line, sizeof(line), in)) {
+            if (line[0] == '#' || line[0] == '\n') continue;
+            char type[16], brand[128];
+            int model, power, capacity, voltage, rpm, on;
+            if (std::sscanf(line, "%15[^;];%127[^;];%d;%d;%d;%d;%d;%d", type, brand, &model, &power, &capacity,
+                            &voltage, &rpm, &on) != 8) {
+                std::fclose(in);
+                return -1;
+            }
+            bool drill = std::strcmp(type, "drill") == 0;
+            if (!drill && std::strcmp(type, "fridge") != 0) {
+                std::fclose(in);
+                return -1;
+            }
+            MemoryTagScope memory(MemoryTag::Devices);
+            std::string name = brand;
+            name += drill ? " Drill " : " Fridge ";
+            AppendInt(name, model);
+            std::unique_ptr<AbstractElectricDevice> device;
+            if (drill) device = std::make_unique<Drill>(name, power, voltage, rpm, brand);
+            else device = std::make_unique<Refrigerator>(name, power, brand, capacity);
+            if (on) device->TurnOn();
+            devices.push_back(std::move(device));
+        }
+        std::fclose(in);
+        long long count = static_cast<long long>(devices.size());
+        manager.AddDevices(std::move(devices));
+        return count;
+    }
+};
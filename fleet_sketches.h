@@ -0,0 +1,329 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// === Потоковые скетчи парка устройств ===
+// Приближённые отчёты без полного обхода устройств: квантили мощности
+// (KLL), число различных производителей (HyperLogLog) и самые частые
+// модели (Space-Saving). Каждый скетч занимает фиксированную память,
+// обновляется за O(1) амортизированно и сливается с таким же скетчем
+// другого шарда: результат слияния — скетч объединённого потока.
+// Ключи — хеши строк (FlatNameMap::Hash), а не номера словарей, поэтому
+// скетчи разных менеджеров совместимы
+
+// --- Квантили: KLL (Karnin, Lang, Liberty) ---
+// Уровень h хранит элементы с весом 2^h. Переполненный уровень
+// сортируется, и каждый второй элемент (чётные или нечётные позиции —
+// случайно) переходит на уровень выше. Ёмкость уровней убывает вниз
+// геометрически (k · (2/3)^глубина), поэтому памяти O(k), а ошибка ранга
+// около 1.7/k от числа элементов (k = 200 — порядка 1%)
+class KllSketch {
+private:
+    static constexpr double kDecay = 2.0 / 3.0;
+
+    std::uint32_t _k;
+    std::vector<std::vector<std::int32_t>> _levels;
+    std::vector<std::size_t> _capacity;  // по уровням; пересчитывается при росте высоты
+    std::size_t _size = 0;
+    std::size_t _totalCapacity = 0;
+    std::uint64_t _count = 0;
+    std::int32_t _min = 0;
+    std::int32_t _max = 0;
+    std::uint64_t _random = 0x9e3779b97f4a7c15ull;
+
+    bool RandomBit() {
+        // xorshift64: для выбора половины при уплотнении достаточно
+        _random ^= _random << 13;
+        _random ^= _random >> 7;
+        _random ^= _random << 17;
+        return _random & 1;
+    }
+
+    void UpdateCapacities() {
+        std::size_t height = _levels.size();
+        _capacity.resize(height);
+        _totalCapacity = 0;
+        for (std::size_t h = 0; h < height; ++h) {
+            double capacity = std::ceil(_k * std::pow(kDecay, static_cast<double>(height - 1 - h)));
+            _capacity[h] = std::max<std::size_t>(2, static_cast<std::size_t>(capacity));
+            _totalCapacity += _capacity[h];
+        }
+    }
+
+    void Compact() {
+        while (_size > _totalCapacity) {
+            std::size_t h = 0;
+            while (_levels[h].size() < _capacity[h]) ++h;
+            if (h + 1 == _levels.size()) {
+                _levels.emplace_back();
+                UpdateCapacities();
+            }
+            std::vector<std::int32_t>& level = _levels[h];
+            std::vector<std::int32_t>& above = _levels[h + 1];
+            std::sort(level.begin(), level.end());
+            // При нечётном размере один элемент остаётся на своём уровне
+            std::size_t keep = level.size() % 2;
+            for (std::size_t i = keep + (RandomBit() ? 1 : 0); i < level.size(); i += 2) above.push_back(level[i]);
+            _size -= level.size() - keep - (level.size() - keep) / 2;
+            level.resize(keep);
+        }
+    }
+
+public:
+    explicit KllSketch(std::uint32_t k = 200) : _k(std::max<std::uint32_t>(k, 8)), _levels(1) { UpdateCapacities(); }
+
+    void Add(std::int32_t value) {
+        if (_count == 0 || value < _min) _min = value;
+        if (_count == 0 || value > _max) _max = value;
+        ++_count;
+        _levels[0].push_back(value);
+        if (++_size > _totalCapacity) Compact();
+    }
+
+    // Сливает other в этот скетч; параметр k у обоих должен совпадать
+    void Merge(const KllSketch& other) {
+        if (other._count == 0) return;
+        if (_count == 0 || other._min < _min) _min = other._min;
+        if (_count == 0 || other._max > _max) _max = other._max;
+        _count += other._count;
+        if (other._levels.size() > _levels.size()) {
+            _levels.resize(other._levels.size());
+            UpdateCapacities();
+        }
+        for (std::size_t h = 0; h < other._levels.size(); ++h) {
+            _levels[h].insert(_levels[h].end(), other._levels[h].begin(), other._levels[h].end());
+            _size += other._levels[h].size();
+        }
+        Compact();
+    }
+
+    std::uint64_t Count() const { return _count; }
+    std::int32_t Min() const { return _min; }
+    std::int32_t Max() const { return _max; }
+    std::size_t RetainedItems() const { return _size; }
+
+    // Приближённый q-квантиль, q в [0, 1]; 0 для пустого скетча
+    std::int32_t Quantile(double q) const {
+        if (_count == 0) return 0;
+        if (q <= 0) return _min;
+        if (q >= 1) return _max;
+        std::vector<std::pair<std::int32_t, std::uint64_t>> weighted;
+        weighted.reserve(_size);
+        std::uint64_t total = 0;
+        for (std::size_t h = 0; h < _levels.size(); ++h) {
+            for (std::int32_t value : _levels[h]) weighted.emplace_back(value, std::uint64_t(1) << h);
+            total += _levels[h].size() << h;
+        }
+        std::sort(weighted.begin(), weighted.end());
+        double target = q * static_cast<double>(total);
+        std::uint64_t cumulative = 0;
+        for (const auto& item : weighted) {
+            cumulative += item.second;
+            if (static_cast<double>(cumulative) >= target) return item.first;
+        }
+        return _max;
+    }
+};
+
+// --- Число различных значений: HyperLogLog ---
+// 2^kPrecision регистров по байту; в регистре — наибольшая позиция первой
+// единицы среди хешей, попавших в него. Стандартная ошибка 1.04/√m (1.6%
+// при m = 4096); на малых числах — линейный подсчёт пустых регистров.
+// Слияние — поэлементный максимум регистров
+class HyperLogLog {
+public:
+    static constexpr unsigned kPrecision = 12;
+    static constexpr std::size_t kRegisters = std::size_t(1) << kPrecision;
+
+private:
+    std::vector<std::uint8_t> _registers = std::vector<std::uint8_t>(kRegisters, 0);
+
+    static unsigned LeadingZeros(std::uint64_t x) {
+#ifdef _MSC_VER
+        unsigned long index;
+        _BitScanReverse64(&index, x);
+        return 63u - static_cast<unsigned>(index);
+#else
+        return static_cast<unsigned>(__builtin_clzll(x));
+#endif
+    }
+
+public:
+    // hash — 64-битный хеш значения; дополнительно перемешивается (splitmix64)
+    void Add(std::uint64_t hash) {
+        hash ^= hash >> 30;
+        hash *= 0xbf58476d1ce4e5b9ull;
+        hash ^= hash >> 27;
+        hash *= 0x94d049bb133111ebull;
+        hash ^= hash >> 31;
+        std::size_t index = static_cast<std::size_t>(hash >> (64 - kPrecision));
+        // Сторожевая единица ограничивает ранг, если оставшиеся биты нулевые
+        std::uint64_t rest = (hash << kPrecision) | (std::uint64_t(1) << (kPrecision - 1));
+        std::uint8_t rank = static_cast<std::uint8_t>(LeadingZeros(rest) + 1);
+        if (rank > _registers[index]) _registers[index] = rank;
+    }
+
+    void Merge(const HyperLogLog& other) {
+        for (std::size_t i = 0; i < kRegisters; ++i) _registers[i] = std::max(_registers[i], other._registers[i]);
+    }
+
+    double Estimate() const {
+        double m = static_cast<double>(kRegisters);
+        double sum = 0;
+        std::size_t zeros = 0;
+        for (std::uint8_t rank : _registers) {
+            sum += std::ldexp(1.0, -static_cast<int>(rank));
+            zeros += rank == 0;
+        }
+        double estimate = 0.7213 / (1 + 1.079 / m) * m * m / sum;
+        if (estimate <= 2.5 * m && zeros > 0) estimate = m * std::log(m / static_cast<double>(zeros));
+        return estimate;
+    }
+};
+
+// --- Самые частые ключи: Space-Saving (Metwally, Agrawal, El Abbadi) ---
+// kCounters счётчиков; новый ключ при заполнении вытесняет счётчик с
+// наименьшим значением и наследует его как ошибку. Любой ключ с частотой
+// больше N/kCounters гарантированно в таблице, а счёт завышен не больше,
+// чем на error. Ключи хранятся подряд: поиск — линейный проход по kCounters
+// хешам (четыре кеш-линии). Вызывающий может хранить номер счётчика ключа
+// (slot): если ключ всё ещё там, поиска нет вовсе
+class SpaceSaving {
+public:
+    static constexpr std::size_t kCounters = 32;
+
+    struct Entry {
+        std::string label;
+        std::uint64_t count = 0;
+        std::uint64_t error = 0;  // верхняя граница завышения count
+    };
+
+private:
+    std::uint64_t _keys[kCounters] = {};
+    Entry _entries[kCounters];
+    std::size_t _used = 0;
+    std::uint64_t _total = 0;
+
+    std::size_t MinIndex() const {
+        std::size_t min = 0;
+        for (std::size_t i = 1; i < _used; ++i) {
+            if (_entries[i].count < _entries[min].count) min = i;
+        }
+        return min;
+    }
+
+    // Наименьший счёт заполненной таблицы: столько мог набрать любой
+    // ключ, которого в ней нет
+    std::uint64_t Floor() const { return _used == kCounters ? _entries[MinIndex()].count : 0; }
+
+    std::size_t Find(std::uint64_t key) const {
+        for (std::size_t i = 0; i < _used; ++i) {
+            if (_keys[i] == key) return i;
+        }
+        return kCounters;
+    }
+
+public:
+    void Add(std::uint64_t key, std::string_view label, std::uint64_t count = 1) {
+        std::uint32_t slot = 0;
+        Add(key, label, count, slot);
+    }
+
+    // slot — подсказка номера счётчика; обновляется, если ключ переехал
+    void Add(std::uint64_t key, std::string_view label, std::uint64_t count, std::uint32_t& slot) {
+        _total += count;
+        if (slot < _used && _keys[slot] == key) {
+            _entries[slot].count += count;
+            return;
+        }
+        std::size_t i = Find(key);
+        if (i == kCounters) {
+            if (_used < kCounters) {
+                i = _used++;
+                _entries[i].error = 0;
+                _entries[i].count = 0;
+            } else {
+                i = MinIndex();
+                _entries[i].error = _entries[i].count;
+            }
+            _keys[i] = key;
+            _entries[i].label.assign(label.data(), label.size());
+        }
+        slot = static_cast<std::uint32_t>(i);
+        _entries[i].count += count;
+    }
+
+    // Слияние по Agarwal и др. (Mergeable Summaries): отсутствующему в
+    // одной из таблиц ключу добавляется её наименьший счёт, затем остаются
+    // kCounters наибольших
+    void Merge(const SpaceSaving& other) {
+        std::uint64_t floor = Floor();
+        std::uint64_t otherFloor = other.Floor();
+        std::vector<std::pair<std::uint64_t, Entry>> merged;
+        merged.reserve(_used + other._used);
+        for (std::size_t i = 0; i < _used; ++i) {
+            Entry entry = _entries[i];
+            std::size_t j = other.Find(_keys[i]);
+            std::uint64_t add = j == kCounters ? otherFloor : other._entries[j].count;
+            std::uint64_t addError = j == kCounters ? otherFloor : other._entries[j].error;
+            entry.count += add;
+            entry.error += addError;
+            merged.emplace_back(_keys[i], std::move(entry));
+        }
+        for (std::size_t j = 0; j < other._used; ++j) {
+            if (Find(other._keys[j]) != kCounters) continue;
+            Entry entry = other._entries[j];
+            entry.count += floor;
+            entry.error += floor;
+            merged.emplace_back(other._keys[j], std::move(entry));
+        }
+        std::sort(merged.begin(), merged.end(),
+                  [](const auto& a, const auto& b) { return a.second.count > b.second.count; });
+        if (merged.size() > kCounters) merged.resize(kCounters);
+        _used = merged.size();
+        for (std::size_t i = 0; i < _used; ++i) {
+            _keys[i] = merged[i].first;
+            _entries[i] = std::move(merged[i].second);
+        }
+        _total += other._total;
+    }
+
+    std::uint64_t Total() const { return _total; }
+
+    // До n ключей по убыванию счёта
+    std::vector<Entry> Top(std::size_t n) const {
+        std::vector<Entry> top(_entries, _entries + _used);
+        std::sort(top.begin(), top.end(), [](const Entry& a, const Entry& b) { return a.count > b.count; });
+        if (top.size() > n) top.resize(n);
+        return top;
+    }
+};
+
+// --- Набор скетчей DeviceManager ---
+// Обновляется при добавлении устройства (номинальная мощность,
+// производитель, модель) и при каждом включении (модель). Модель —
+// «производитель тип», например «Bosch Drill»
+struct FleetSketches {
+    KllSketch ratedPower;
+    HyperLogLog brands;
+    SpaceSaving models;     // устройства по моделям
+    SpaceSaving switchOns;  // включения по моделям
+
+    void Merge(const FleetSketches& other) {
+        ratedPower.Merge(other.ratedPower);
+        brands.Merge(other.brands);
+        models.Merge(other.models);
+        switchOns.Merge(other.switchOns);
+    }
+};
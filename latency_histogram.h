@@ -0,0 +1,206 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "profiler.h"
+#include "sharded_counter.h"
+
+// === Гистограммы задержек управляющих операций ===
+// Включается определением ELECTRIC_DEVICES_LATENCY_HISTOGRAMS (опция CMake,
+// включена по умолчанию); без него LATENCY_SCOPE — пустая операция.
+//
+// Корзины логарифмически-линейные, как в HdrHistogram: каждый диапазон
+// [2^k, 2^(k+1)) тактов делится на kSubBuckets равных частей, поэтому
+// относительная ошибка перцентиля не больше 1/kSubBuckets при любой
+// величине. Длительности хранятся в тактах CycleClock и переводятся в
+// наносекунды только при чтении.
+// Запись без блокировок: каждый поток пишет в свою копию гистограммы
+// (номер потока — из CounterSlots), Snapshot складывает копии.
+// Пакетные вызовы (TurnOn по списку, TurnOnAll, AddDevices) дают один
+// замер на вызов — это задержка, которую видит управляющая сторона
+
+enum class LatencyOp : std::uint8_t {
+    TurnOn,
+    TurnOff,
+    AddDevice,
+    GetTotalPower,
+    Log,
+    Count
+};
+
+inline const char* LatencyOpName(LatencyOp op) {
+    switch (op) {
+        case LatencyOp::TurnOn: return "TurnOn";
+        case LatencyOp::TurnOff: return "TurnOff";
+        case LatencyOp::AddDevice: return "AddDevice";
+        case LatencyOp::GetTotalPower: return "GetTotalPower";
+        case LatencyOp::Log: return "Log";
+        case LatencyOp::Count: break;
+    }
+    return "?";
+}
+
+// --- Слитая гистограмма одной операции ---
+struct LatencySnapshot {
+    static constexpr unsigned kSubBucketBits = 4;
+    static constexpr std::size_t kSubBuckets = std::size_t(1) << kSubBucketBits;
+    // Старший учитываемый разряд: всё от 2^kMaxBits тактов — в последней корзине
+    static constexpr unsigned kMaxBits = 40;
+    static constexpr std::size_t kBuckets = (kMaxBits - kSubBucketBits + 1) * kSubBuckets;
+
+    std::uint64_t count = 0;
+    std::uint64_t totalTicks = 0;
+    std::uint64_t maxTicks = 0;
+    std::uint64_t buckets[kBuckets] = {};
+
+    static std::size_t BucketOf(std::uint64_t ticks) {
+        if (ticks < kSubBuckets) return static_cast<std::size_t>(ticks);
+#ifdef _MSC_VER
+        unsigned long index;
+        _BitScanReverse64(&index, ticks);
+        unsigned top = static_cast<unsigned>(index);
+#else
+        unsigned top = 63u - static_cast<unsigned>(__builtin_clzll(ticks));
+#endif
+        if (top >= kMaxBits) return kBuckets - 1;
+        unsigned shift = top - kSubBucketBits;
+        return (top - kSubBucketBits + 1) * kSubBuckets + static_cast<std::size_t>((ticks >> shift) & (kSubBuckets - 1));
+    }
+
+    // Верхняя граница корзины в тактах (наибольшее попадающее в неё значение)
+    static std::uint64_t BucketLimit(std::size_t bucket) {
+        if (bucket < kSubBuckets) return bucket;
+        std::size_t shift = bucket / kSubBuckets - 1;
+        std::uint64_t sub = bucket % kSubBuckets + kSubBuckets;
+        return ((sub + 1) << shift) - 1;
+    }
+
+    // Значение q-го перцентиля (0..100) в наносекундах; не больше максимума
+    double PercentileNs(double q) const {
+        if (count == 0) return 0;
+        std::uint64_t rank = static_cast<std::uint64_t>(q / 100.0 * static_cast<double>(count) + 0.5);
+        if (rank < 1) rank = 1;
+        if (rank > count) rank = count;
+        std::uint64_t seen = 0;
+        for (std::size_t b = 0; b < kBuckets; ++b) {
+            seen += buckets[b];
+            if (seen >= rank) {
+                std::uint64_t limit = BucketLimit(b);
+                return CycleClock::ToNanoseconds(limit < maxTicks ? limit : maxTicks);
+            }
+        }
+        return CycleClock::ToNanoseconds(maxTicks);
+    }
+
+    double MeanNs() const { return count ? CycleClock::ToNanoseconds(totalTicks) / static_cast<double>(count) : 0; }
+    double MaxNs() const { return CycleClock::ToNanoseconds(maxTicks); }
+    double TotalNs() const { return CycleClock::ToNanoseconds(totalTicks); }
+};
+
+class LatencyStats {
+public:
+#ifdef ELECTRIC_DEVICES_LATENCY_HISTOGRAMS
+    static constexpr bool kEnabled = true;
+#else
+    static constexpr bool kEnabled = false;
+#endif
+
+private:
+    static constexpr std::size_t kOps = static_cast<std::size_t>(LatencyOp::Count);
+    static constexpr std::size_t kBuckets = LatencySnapshot::kBuckets;
+
+    // Копия гистограммы одного потока. Владелец пишет обычными загрузкой и
+    // сохранением; копия для потоков сверх CounterSlots::kSlots общая и
+    // обновляется через fetch_add (максимум в ней — CAS)
+    struct alignas(64) Shard {
+        std::atomic<std::uint64_t> count{0};
+        std::atomic<std::uint64_t> total{0};
+        std::atomic<std::uint64_t> max{0};
+        std::atomic<std::uint64_t> buckets[kBuckets] = {};
+    };
+
+    struct Histogram {
+        Shard shards[CounterSlots::kSlots];
+        Shard overflow;
+    };
+
+    // Массивы без инициализаторов, кроме нулей: лежат в .bss и занимают
+    // физическую память только в тех страницах, куда реально писали
+    static Histogram* Histograms() {
+        static Histogram histograms[kOps];
+        return histograms;
+    }
+
+    static void Bump(std::atomic<std::uint64_t>& cell, std::uint64_t delta) {
+        cell.store(cell.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+    }
+
+public:
+    static void Record(LatencyOp op, std::uint64_t ticks) {
+        Histogram& histogram = Histograms()[static_cast<std::size_t>(op)];
+        std::size_t bucket = LatencySnapshot::BucketOf(ticks);
+        int slot = CounterSlots::Current();
+        if (slot == CounterSlots::kOverflow) {
+            Shard& shard = histogram.overflow;
+            shard.count.fetch_add(1, std::memory_order_relaxed);
+            shard.total.fetch_add(ticks, std::memory_order_relaxed);
+            shard.buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+            std::uint64_t max = shard.max.load(std::memory_order_relaxed);
+            while (ticks > max && !shard.max.compare_exchange_weak(max, ticks, std::memory_order_relaxed)) {
+            }
+            return;
+        }
+        Shard& shard = histogram.shards[slot];
+        Bump(shard.count, 1);
+        Bump(shard.total, ticks);
+        Bump(shard.buckets[bucket], 1);
+        if (ticks > shard.max.load(std::memory_order_relaxed)) shard.max.store(ticks, std::memory_order_relaxed);
+    }
+
+    // Сумма копий всех потоков. Потоки, не писавшие в операцию, пропускаются
+    // по нулевому счётчику, не трогая их корзин
+    static void Snapshot(LatencyOp op, LatencySnapshot& out) {
+        out = LatencySnapshot();
+        const Histogram& histogram = Histograms()[static_cast<std::size_t>(op)];
+        auto merge = [&out](const Shard& shard) {
+            if (shard.count.load(std::memory_order_relaxed) == 0) return;
+            std::uint64_t count = 0;
+            for (std::size_t b = 0; b < kBuckets; ++b) {
+                std::uint64_t n = shard.buckets[b].load(std::memory_order_relaxed);
+                out.buckets[b] += n;
+                count += n;
+            }
+            // count берётся из корзин, чтобы перцентили сходились при записи в процессе чтения
+            out.count += count;
+            out.totalTicks += shard.total.load(std::memory_order_relaxed);
+            std::uint64_t max = shard.max.load(std::memory_order_relaxed);
+            if (max > out.maxTicks) out.maxTicks = max;
+        };
+        for (const Shard& shard : histogram.shards) merge(shard);
+        merge(histogram.overflow);
+    }
+};
+
+// --- Замер до конца блока ---
+class LatencyScope {
+private:
+    LatencyOp _op;
+    std::uint64_t _start;
+
+public:
+    explicit LatencyScope(LatencyOp op) : _op(op), _start(CycleClock::Now()) {}
+    ~LatencyScope() { LatencyStats::Record(_op, CycleClock::Now() - _start); }
+
+    LatencyScope(const LatencyScope&) = delete;
+    LatencyScope& operator=(const LatencyScope&) = delete;
+};
+
+#ifdef ELECTRIC_DEVICES_LATENCY_HISTOGRAMS
+#define LATENCY_CONCAT_INNER(a, b) a##b
+#define LATENCY_CONCAT(a, b) LATENCY_CONCAT_INNER(a, b)
+#define LATENCY_SCOPE(op) LatencyScope LATENCY_CONCAT(latencyScope_, __LINE__)(op)
+#else
+#define LATENCY_SCOPE(op) ((void)0)
+#endif
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <memory>
+
+#include "alloc_tracker.h"
+#include "latency_histogram.h"
+#include "memory_accounting.h"
+#include "profiler.h"
+#include "sharded_counter.h"
+#include "trace.h"
+
+// --- Уровни важности сообщений ---
+enum class LogLevel { Debug, Info, Warning, Error, Off };
+
+// === Интерфейс логгера ===
+// Перед построением сообщения вызывающий проверяет IsEnabled: при
+// отключённом уровне строка не собирается и память не выделяется
+class ILogger {
+private:
+    LogLevel _level = LogLevel::Info;
+
+public:
+    virtual void Log(const std::string& message) = 0;
+    virtual ~ILogger() = default;
+
+    void SetLevel(LogLevel level) { _level = level; }
+    LogLevel GetLevel() const { return _level; }
+    bool IsEnabled(LogLevel level) const { return level >= _level && level != LogLevel::Off; }
+};
+
+// --- Реализация логгера: Консоль ---
+class ConsoleLogger : public ILogger {
+public:
+    void Log(const std::string& message) override {
+        ALLOC_SITE("ConsoleLogger::Log");
+        PROFILE_SCOPE("ConsoleLogger::Log");
+        LATENCY_SCOPE(LatencyOp::Log);
+        MemoryTagScope memory(MemoryTag::Logs);
+        TRACE_SPAN_ARG("ConsoleLogger::Log", "bytes", message.size());
+        OperationalStats::Get().messagesLogged.Increment();
+        OperationalStats::Get().bytesLogged.Add(static_cast<std::int64_t>(message.size()));
+        std::cout << "[Console] " << message << "\n";
+    }
+};
+
+// --- Реализация логгера: Файл ---
+class FileLogger : public ILogger {
+private:
+    std::ofstream _file;
+
+public:
+    FileLogger(const std::string& filename) {
+        MemoryTagScope memory(MemoryTag::Logs);
+        _file.open(filename, std::ios::app);
+    }
+
+    void Log(const std::string& message) override {
+        ALLOC_SITE("FileLogger::Log");
+        PROFILE_SCOPE("FileLogger::Log");
+        LATENCY_SCOPE(LatencyOp::Log);
+        MemoryTagScope memory(MemoryTag::Logs);
+        TRACE_SPAN_ARG("FileLogger::Log", "bytes", message.size());
+        OperationalStats::Get().messagesLogged.Increment();
+        OperationalStats::Get().bytesLogged.Add(static_cast<std::int64_t>(message.size()));
+        if (_file.is_open()) {
+            _file << "[File] " << message << "\n";
+        }
+    }
+
+    ~FileLogger() {
+        if (_file.is_open()) _file.close();
+    }
+};
+
+// --- Реализация логгера: Пустой (для бенчмарков и тихих режимов) ---
+class NullLogger : public ILogger {
+public:
+    NullLogger() { SetLevel(LogLevel::Off); }
+
+    void Log(const std::string&) override {}
+};
+
+// --- Пакетный логгер: копит записи и выдаёт их одной сводной записью ---
+class BatchLogger : public ILogger {
+private:
+    std::shared_ptr<ILogger> _target;
+    std::string _pending;
+    std::size_t _count = 0;
+
+public:
+    // Уровень берётся у целевого логгера: при пустом вызывающие не
+    // собирают строки, которые некуда будет передать
+    BatchLogger(std::shared_ptr<ILogger> target) : _target(target) { SetLevel(_target->GetLevel()); }
+
+    void Log(const std::string& message) override {
+        ALLOC_SITE("BatchLogger::Log");
+        PROFILE_SCOPE("BatchLogger::Log");
+        LATENCY_SCOPE(LatencyOp::Log);
+        MemoryTagScope memory(MemoryTag::Logs);
+        if (_count++ > 0) _pending += "; ";
+        _pending += message;
+    }
+
+    // Сколько записей ждут Commit
+    std::size_t GetPendingCount() const { return _count; }
+
+    // Передаёт накопленное целевому логгеру одной записью с заголовком
+    void Commit(const std::string& header) {
+        if (_count == 0) return;
+        PROFILE_SCOPE("BatchLogger::Commit");
+        TRACE_SPAN_ARG("BatchLogger::Commit", "records", _count);
+        MemoryTagScope memory(MemoryTag::Logs);
+        _target->Log(header + ": " + _pending);
+        _pending.clear();
+        _count = 0;
+    }
+};
+
+// --- Фабрика логгеров ---
+class LoggerFactory {
+public:
+    enum LoggerType { Console, File, None };
+
+    static std::shared_ptr<ILogger> CreateLogger(LoggerType type) {
+        if (type == Console) return std::make_shared<ConsoleLogger>();
+        if (type == File) return std::make_shared<FileLogger>("log.txt");
+        if (type == None) return std::make_shared<NullLogger>();
+        return nullptr;
+    }
+};
@@ -1,209 +1,354 @@
-#include <iostream>
-#include <fstream>
-#include <string>
+// Подмена operator new/delete для учёта выделений (если он включён в сборке)
+#define ALLOC_TRACKER_IMPLEMENT
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <memory>
-#include <vector>
+#include <random>
+#include <thread>
+
+#ifndef _WIN32
+#include <csignal>
+#include <pthread.h>
+#endif
+
+#include "command_processor.h"
+#include "console_ui.h"
+#include "control_server.h"
+#include "dashboard.h"
+#include "device_manager.h"
+#include "devices.h"
+#include "fleet_generator.h"
+#include "logger.h"
+#include "metrics.h"
+#include "metrics_server.h"
+#include "profiler.h"
+#include "repl.h"
+#include "shared_totals.h"
+#include "telemetry.h"
+#include "telemetry_pipeline.h"
+#include "trace.h"
+
+// Сервер метрик запускается, если задан ELECTRIC_DEVICES_METRICS_PORT
+static bool StartMetrics(MetricsServer& server) {
+    const char* port = std::getenv("ELECTRIC_DEVICES_METRICS_PORT");
+    if (!port) return false;
+    std::string error;
+    if (!server.Start(static_cast<std::uint16_t>(std::atoi(port)), error)) {
+        std::fprintf(stderr, "Сервер метрик не запущен: %s\n", error.c_str());
+        return false;
+    }
+    std::fprintf(stderr, "Метрики: http://127.0.0.1:%u/metrics\n", static_cast<unsigned>(server.Port()));
+    return true;
+}
 
-// === Интерфейс логгера ===
-class ILogger {
-public:
-    virtual void Log(const std::string& message) = 0;
-    virtual ~ILogger() = default;
-};
+// Итоги в разделяемой памяти, если задан ELECTRIC_DEVICES_SHM_TOTALS (имя сегмента)
+static void StartSharedTotals(SharedTotalsPublisher& publisher, DeviceManager& manager) {
+    const char* name = std::getenv("ELECTRIC_DEVICES_SHM_TOTALS");
+    if (!name) return;
+    std::string error;
+    if (!publisher.Open(name, error)) {
+        std::fprintf(stderr, "Итоги в разделяемой памяти не опубликованы: %s\n", error.c_str());
+        return;
+    }
+    manager.PublishTotalsTo(&publisher);
+}
 
-// --- Реализация логгера: Консоль ---
-class ConsoleLogger : public ILogger {
-public:
-    void Log(const std::string& message) override {
-        std::cout << "[Console] " << message << "\n";
+// --- Чтение итогов другого процесса: ElectricDevices --read-totals <сегмент> [раз] [интервал, мс] ---
+static int RunReadTotals(const char* name, std::size_t samples, unsigned intervalMs) {
+    SharedTotalsReader reader;
+    std::string error;
+    if (!reader.Open(name, error)) {
+        std::fprintf(stderr, "Не удалось открыть %s: %s\n", name, error.c_str());
+        return 1;
+    }
+    SharedTotals totals;
+    for (std::size_t i = 0; samples == 0 || i < samples; ++i) {
+        if (i > 0) std::this_thread::sleep_for(std::chrono::milliseconds(intervalMs));
+        reader.Read(totals);
+        std::printf("power %lld W, devices %llu, on %llu, version %llu", totals.totalPower,
+                    static_cast<unsigned long long>(totals.deviceCount),
+                    static_cast<unsigned long long>(totals.onCount),
+                    static_cast<unsigned long long>(totals.version));
+        for (std::uint32_t g = 0; g < totals.groupCount; ++g) {
+            std::printf("; %s %lld W (%llu/%llu on)", totals.groups[g].name, totals.groups[g].power,
+                        static_cast<unsigned long long>(totals.groups[g].onCount),
+                        static_cast<unsigned long long>(totals.groups[g].count));
+        }
+        std::printf("\n");
+        std::fflush(stdout);
     }
-};
+    return 0;
+}
 
-// --- Реализация логгера: Файл ---
-class FileLogger : public ILogger {
-private:
-    std::ofstream _file;
+// --- Режим панели мониторинга: ElectricDevices --dashboard [Гц] [устройств] ---
+static int RunDashboard(double refreshHz, std::size_t deviceCount) {
+    SharedTotalsPublisher sharedTotals;
+    DeviceManager manager(LoggerFactory::CreateLogger(LoggerFactory::None));
+
+    FleetSpec spec;
+    spec.count = deviceCount;
+    FleetGenerator(spec).Populate(manager);
+    StartSharedTotals(sharedTotals, manager);
+
+    MetricsPublisher metrics;
+    MetricsServer server(metrics);
+    bool publish = StartMetrics(server);
+    manager.SampleDemand();
+    if (publish) metrics.Publish(manager);
+
+    // Симуляция нагрузки: на каждом кадре переключается одно устройство
+    std::mt19937_64 random(42);
+    Dashboard dashboard(manager);
+    dashboard.Run(refreshHz, 0, [&] {
+        if (deviceCount == 0) return;
+        std::size_t index = random() % deviceCount;
+        if (manager.GetDevices()[index]->IsOn()) manager.TurnOff(index);
+        else manager.TurnOn(index);
+        if (publish) metrics.Publish(manager);
+    });
+    return 0;
+}
 
-public:
-    FileLogger(const std::string& filename) {
-        _file.open(filename, std::ios::app);
+// --- Генерация снимка: ElectricDevices --generate <устройств> <файл> [seed] ---
+static int RunGenerate(std::size_t deviceCount, const char* path, std::uint64_t seed) {
+    FleetSpec spec;
+    spec.count = deviceCount;
+    spec.seed = seed;
+    if (!FleetGenerator(spec).WriteSnapshot(path)) {
+        std::fprintf(stderr, "Не удалось записать снимок: %s\n", path);
+        return 1;
     }
+    return 0;
+}
 
-    void Log(const std::string& message) override {
-        if (_file.is_open()) {
-            _file << "[File] " << message << "\n";
-        }
+// --- Безынтерфейсный режим: ElectricDevices --headless [файл команд] ---
+static int RunHeadless(const char* path) {
+    std::FILE* in = path ? std::fopen(path, "rb") : stdin;
+    if (!in) {
+        std::fprintf(stderr, "Не удалось открыть файл команд: %s\n", path);
+        return 1;
     }
 
-    ~FileLogger() {
-        if (_file.is_open()) _file.close();
-    }
-};
-
-// --- Фабрика логгеров ---
-class LoggerFactory {
-public:
-    enum LoggerType { Console, File };
-
-    static std::shared_ptr<ILogger> CreateLogger(LoggerType type) {
-        if (type == Console) return std::make_shared<ConsoleLogger>();
-        if (type == File) return std::make_shared<FileLogger>("log.txt");
-        return nullptr;
-    }
-};
+    SharedTotalsPublisher sharedTotals;
+    DeviceManager manager(LoggerFactory::CreateLogger(LoggerFactory::None));
+    StartSharedTotals(sharedTotals, manager);
+    CommandProcessor processor(manager);
+    processor.Run(in);
 
-// === Абстрактный класс электроприбора ===
-class AbstractElectricDevice {
-protected:
-    std::string _name;
-    int _power;
-    bool _isOn;
+    if (path) std::fclose(in);
+    return 0;
+}
 
-public:
-    AbstractElectricDevice(const std::string& name, int power)
-        : _name(name), _power(power), _isOn(false) {}
-
-    virtual void TurnOn() { _isOn = true; }
-    virtual void TurnOff() { _isOn = false; }
-    virtual int GetPower() const { return _isOn ? _power : 0; }
-    virtual std::string GetInfo() const = 0;
-    virtual ~AbstractElectricDevice() = default;
-};
-
-// --- Бытовая техника ---
-class HomeAppliance : public AbstractElectricDevice {
-protected:
-    std::string _brand;
-
-public:
-    HomeAppliance(const std::string& name, int power, const std::string& brand)
-        : AbstractElectricDevice(name, power), _brand(brand) {}
-};
-
-// --- Электроинструмент ---
-class PowerTool : public AbstractElectricDevice {
-protected:
-    int _voltage;
-
-public:
-    PowerTool(const std::string& name, int power, int voltage)
-        : AbstractElectricDevice(name, power), _voltage(voltage) {}
-};
-
-// --- Холодильник ---
-class Refrigerator : public HomeAppliance {
-private:
-    int _capacity;
-
-public:
-    Refrigerator(const std::string& name, int power, const std::string& brand, int capacity)
-        : HomeAppliance(name, power, brand), _capacity(capacity) {}
-
-    std::string GetInfo() const override {
-        return "Refrigerator: " + _name + ", Brand: " + _brand +
-               ", Capacity: " + std::to_string(_capacity) + "L, Power: " + std::to_string(_power) + "W";
-    }
-};
-
-// --- Дрель ---
-class Drill : public PowerTool {
-private:
-    int _rpm;
-
-public:
-    Drill(const std::string& name, int power, int voltage, int rpm)
-        : PowerTool(name, power, voltage), _rpm(rpm) {}
-
-    std::string GetInfo() const override {
-        return "Drill: " + _name + ", Voltage: " + std::to_string(_voltage) +
-               "V, RPM: " + std::to_string(_rpm) + ", Power: " + std::to_string(_power) + "W";
-    }
-};
-
-// === Интерфейс фабрики устройств ===
-class DeviceFactory {
-public:
-    virtual std::unique_ptr<AbstractElectricDevice> Create() const = 0;
-    virtual ~DeviceFactory() = default;
-};
-
-// --- Фабрика холодильников ---
-class RefrigeratorFactory : public DeviceFactory {
-public:
-    std::unique_ptr<AbstractElectricDevice> Create() const override {
-        return std::make_unique<Refrigerator>("Samsung Fridge", 150, "Samsung", 300);
-    }
-};
-
-// --- Фабрика дрелей ---
-class DrillFactory : public DeviceFactory {
-public:
-    std::unique_ptr<AbstractElectricDevice> Create() const override {
-        return std::make_unique<Drill>("Bosch Drill", 800, 220, 3000);
-    }
-};
-
-// === Класс логики приложения ===
-class DeviceManager {
-private:
-    std::vector<std::unique_ptr<AbstractElectricDevice>> _devices;
-    std::shared_ptr<ILogger> _logger;
-
-public:
-    DeviceManager(std::shared_ptr<ILogger> logger) : _logger(logger) {}
-
-    void AddDevice(std::unique_ptr<AbstractElectricDevice> device) {
-        _logger->Log("Добавлено устройство: " + device->GetInfo());
-        _devices.push_back(std::move(device));
-    }
-
-    void TurnOnAll() {
-        for (auto& device : _devices) {
-            device->TurnOn();
-            _logger->Log("Включено: " + device->GetInfo());
-        }
+// --- Сервис управления по TCP: ElectricDevices --serve [порт] [устройств] ---
+// Работает до SIGINT или SIGTERM
+static int RunServe(std::uint16_t port, std::size_t deviceCount) {
+#ifdef _WIN32
+    (void)port;
+    (void)deviceCount;
+    std::fprintf(stderr, "Сервер управления не поддерживается на Windows\n");
+    return 1;
+#else
+    // Сигналы ждёт только главный поток; потоки серверов наследуют маску
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+    SharedTotalsPublisher sharedTotals;
+    DeviceManager manager(LoggerFactory::CreateLogger(LoggerFactory::None));
+    FleetSpec spec;
+    spec.count = deviceCount;
+    if (deviceCount > 0) FleetGenerator(spec).Populate(manager);
+    StartSharedTotals(sharedTotals, manager);
+
+    MetricsPublisher metrics;
+    MetricsServer metricsServer(metrics);
+    ControlServer server(manager);
+    bool publish = StartMetrics(metricsServer);
+    manager.SampleDemand();
+    if (publish) metrics.Publish(manager);
+    server.SetBatchHook([&] {
+        manager.SampleDemand();
+        if (publish) metrics.Publish(manager);
+    });
+    std::string error;
+    if (!server.Start(port, error)) {
+        std::fprintf(stderr, "Сервер управления не запущен: %s\n", error.c_str());
+        return 1;
     }
+    std::fprintf(stderr, "Сервер управления: 127.0.0.1:%u\n", static_cast<unsigned>(server.Port()));
 
-    int GetTotalPower() const {
-        int total = 0;
-        for (const auto& device : _devices) {
-            total += device->GetPower();
+    int signal = 0;
+    sigwait(&signals, &signal);
+    server.Stop();
+    return 0;
+#endif
+}
+
+// --- Приём телеметрии: ElectricDevices --ingest <UDP-порт|путь Unix-сокета> [устройств] ---
+// Раз в секунду печатает в stderr темп приёма; работает до SIGINT или SIGTERM
+static int RunIngest(const char* endpoint, std::size_t deviceCount) {
+#ifdef _WIN32
+    (void)endpoint;
+    (void)deviceCount;
+    std::fprintf(stderr, "Приём телеметрии не поддерживается на Windows\n");
+    return 1;
+#else
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+    SharedTotalsPublisher sharedTotals;
+    DeviceManager manager(LoggerFactory::CreateLogger(LoggerFactory::None));
+    FleetSpec spec;
+    spec.count = deviceCount;
+    if (deviceCount > 0) FleetGenerator(spec).Populate(manager);
+    StartSharedTotals(sharedTotals, manager);
+
+    // Показания разбираются, агрегируются по окнам и сверяются с порогами
+    // в конвейере параллельно с применением к менеджеру
+    TelemetryPipeline pipeline(TelemetryPipeline::Config::FromManager(manager));
+    MetricsPublisher metrics;
+    metrics.SetPipeline(&pipeline);
+    MetricsServer metricsServer(metrics);
+    TelemetryIngest ingest;
+    ingest.SetSink(&pipeline);
+    pipeline.Start();
+    bool publish = StartMetrics(metricsServer);
+    manager.SampleDemand();
+    if (publish) metrics.Publish(manager);
+    ingest.SetBatchHook([&] {
+        manager.SampleDemand();
+        if (publish) metrics.Publish(manager);
+    });
+
+    std::string error;
+    bool udp = std::strspn(endpoint, "0123456789") == std::strlen(endpoint);
+    bool opened = udp ? ingest.OpenUdp(static_cast<std::uint16_t>(std::atoi(endpoint)), error)
+                      : ingest.OpenUnix(endpoint, error);
+    if (!opened || !ingest.StartReceiver(error)) {
+        std::fprintf(stderr, "Приём телеметрии не запущен: %s\n", error.c_str());
+        return 1;
+    }
+    ingest.StartApplier(manager);
+    if (udp) std::fprintf(stderr, "Телеметрия: udp://127.0.0.1:%u\n", static_cast<unsigned>(ingest.Port()));
+    else std::fprintf(stderr, "Телеметрия: unix:%s\n", endpoint);
+
+    using Stage = TelemetryPipeline::Stage;
+    constexpr std::size_t kStages = static_cast<std::size_t>(Stage::Count);
+    OperationalStats& stats = OperationalStats::Get();
+    std::int64_t lastApplied = 0;
+    TelemetryPipeline::StageStats last[kStages];
+    timespec second{1, 0};
+    while (sigtimedwait(&signals, nullptr, &second) < 0) {
+        std::int64_t applied = stats.readingsApplied.Value();
+        std::fprintf(stderr, "показаний/с %lld, применено %lld, отброшено %lld, очередь %zu (пик %zu), мощность %lld W\n",
+                     static_cast<long long>(applied - lastApplied), static_cast<long long>(applied),
+                     static_cast<long long>(stats.readingsRejected.Value()), ingest.QueueDepth(),
+                     ingest.QueueHighWater(), ingest.LastTotalPower());
+        lastApplied = applied;
+        // Узкое место — стадия с наибольшей занятостью и полной входной очередью
+        std::fprintf(stderr, "  конвейер:");
+        for (std::size_t i = 0; i < kStages; ++i) {
+            TelemetryPipeline::StageStats now = pipeline.Stats(static_cast<Stage>(i));
+            std::fprintf(stderr, " %s %llu/с, занят %.0f%%, очередь %zu/%zu;", TelemetryPipeline::StageName(static_cast<Stage>(i)),
+                         static_cast<unsigned long long>(now.itemsIn - last[i].itemsIn),
+                         (now.busySeconds - last[i].busySeconds) * 100.0, now.queueDepth, now.queueCapacity);
+            last[i] = now;
         }
-        return total;
+        std::fprintf(stderr, " оповещений %llu\n", static_cast<unsigned long long>(pipeline.AlertCount()));
     }
+    ingest.Stop();
+    pipeline.Stop();
+    return 0;
+#endif
+}
 
-    const std::vector<std::unique_ptr<AbstractElectricDevice>>& GetDevices() const {
-        return _devices;
+// --- Интерактивный режим: ElectricDevices --repl ---
+static int RunRepl() {
+    auto batchLogger = std::make_shared<BatchLogger>(LoggerFactory::CreateLogger(LoggerFactory::Console));
+    SharedTotalsPublisher sharedTotals;
+    DeviceManager manager(batchLogger);
+    StartSharedTotals(sharedTotals, manager);
+    Repl repl(manager, batchLogger);
+
+    MetricsPublisher metrics;
+    MetricsServer server(metrics);
+    if (StartMetrics(server)) {
+        metrics.Publish(manager, batchLogger.get());
+        repl.SetBatchHook([&] { metrics.Publish(manager, batchLogger.get()); });
     }
-};
+    repl.Run();
+    return 0;
+}
 
-// === Интерфейс пользователя ===
-class ConsoleUI {
-private:
-    DeviceManager& _manager;
-    std::shared_ptr<ILogger> _logger;
+// Отчёт профилировщика при выходе: текстом в stderr или JSON в файл
+// из переменной окружения ELECTRIC_DEVICES_PROFILE_JSON
+static void DumpProfile() {
+    const char* jsonPath = std::getenv("ELECTRIC_DEVICES_PROFILE_JSON");
+    std::FILE* json = jsonPath ? std::fopen(jsonPath, "w") : nullptr;
+    if (json) {
+        Profiler::WriteJson(json);
+        std::fclose(json);
+    } else {
+        Profiler::WriteText(stderr);
+    }
+}
 
-public:
-    ConsoleUI(DeviceManager& manager, std::shared_ptr<ILogger> logger)
-        : _manager(manager), _logger(logger) {}
+// Трасса при выходе: в файл из ELECTRIC_DEVICES_TRACE_JSON или trace.json
+static void DumpTrace() {
+    const char* path = std::getenv("ELECTRIC_DEVICES_TRACE_JSON");
+    if (!path) path = "trace.json";
+    std::FILE* out = std::fopen(path, "w");
+    if (!out || !Tracer::WriteChromeJson(out)) std::fprintf(stderr, "cannot write trace to %s\n", path);
+    if (out) std::fclose(out);
+}
 
-    void ShowDevices() const {
-        const auto& devices = _manager.GetDevices();
-        std::cout << "\nСписок устройств:\n";
-        for (const auto& device : devices) {
-            std::cout << device->GetInfo() << "\n";
-        }
+// === Точка входа (main) ===
+int main(int argc, char** argv) {
+    if (Profiler::kEnabled) std::atexit(DumpProfile);
+    if (Tracer::kEnabled) std::atexit(DumpTrace);
+
+    if (argc > 1 && std::strcmp(argv[1], "--dashboard") == 0) {
+        double refreshHz = argc > 2 ? std::atof(argv[2]) : 4.0;
+        std::size_t deviceCount = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 1000;
+        return RunDashboard(refreshHz > 0 ? refreshHz : 4.0, deviceCount);
     }
 
-    void ShowTotalPower() const {
-        int total = _manager.GetTotalPower();
-        std::cout << "Общая мощность: " << total << " W\n";
-        _logger->Log("Общая мощность потребления: " + std::to_string(total) + " W");
+    if (argc > 1 && std::strcmp(argv[1], "--headless") == 0) {
+        return RunHeadless(argc > 2 ? argv[2] : nullptr);
+    }
+
+    if (argc > 3 && std::strcmp(argv[1], "--generate") == 0) {
+        return RunGenerate(std::strtoull(argv[2], nullptr, 10), argv[3],
+                           argc > 4 ? std::strtoull(argv[4], nullptr, 10) : 1);
+    }
+
+    if (argc > 2 && std::strcmp(argv[1], "--read-totals") == 0) {
+        return RunReadTotals(argv[2], argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 1,
+                             argc > 4 ? static_cast<unsigned>(std::strtoul(argv[4], nullptr, 10)) : 100);
+    }
+
+    if (argc > 1 && std::strcmp(argv[1], "--serve") == 0) {
+        return RunServe(static_cast<std::uint16_t>(argc > 2 ? std::atoi(argv[2]) : 7070),
+                        argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 0);
+    }
+
+    if (argc > 2 && std::strcmp(argv[1], "--ingest") == 0) {
+        return RunIngest(argv[2], argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 10000);
+    }
+
+    if (argc > 1 && std::strcmp(argv[1], "--repl") == 0) {
+        return RunRepl();
     }
-};
 
-// === Точка входа (main) ===
-int main() {
     auto logger = LoggerFactory::CreateLogger(LoggerFactory::Console);
 
     DeviceManager manager(logger);
@@ -220,5 +365,6 @@ int main() {
     ui.ShowDevices();
     ui.ShowTotalPower();
 
+    if (AllocTracker::kEnabled) AllocTracker::Report(stderr);
     return 0;
 }
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// === Учёт памяти по подсистемам ===
+// Каждое выделение через глобальный operator new помечается подсистемой,
+// активной в потоке в этот момент (MemoryTagScope), и метка хранится в
+// заголовке блока — освобождение вычитается из той же подсистемы, где бы
+// оно ни произошло. Для каждой подсистемы ведутся живые байты и пик.
+//
+// Подмена operator new/delete находится в alloc_tracker.h и включается
+// определением ELECTRIC_DEVICES_MEMORY_ACCOUNTING (опция CMake, по
+// умолчанию выключена) или ELECTRIC_DEVICES_ALLOC_TRACKING. Без них метки ничего
+// не стоят, а отчёт помечен как недоступный
+
+enum class MemoryTag : std::uint8_t {
+    Other,    // всё, что выделено вне помеченных областей
+    Devices,  // объекты устройств, их строки и колонки DeviceManager
+    Names,    // словари имён, производителей и меток
+    Logs,     // буферы логгеров
+    Indexes,  // индексы имён, битовые карты меток, кеши сортировок
+    Count
+};
+
+inline const char* MemoryTagName(MemoryTag tag) {
+    switch (tag) {
+        case MemoryTag::Other: return "other";
+        case MemoryTag::Devices: return "devices";
+        case MemoryTag::Names: return "names";
+        case MemoryTag::Logs: return "logs";
+        case MemoryTag::Indexes: return "indexes";
+        case MemoryTag::Count: break;
+    }
+    return "?";
+}
+
+struct MemoryUsage {
+    std::int64_t liveBytes = 0;
+    std::int64_t peakBytes = 0;
+};
+
+// Снимок по всем подсистемам; tracked == false, если подмена operator new
+// в сборку не входит и цифры не собирались
+struct MemorySnapshot {
+    bool tracked = false;
+    MemoryUsage usage[static_cast<std::size_t>(MemoryTag::Count)];
+
+    const MemoryUsage& operator[](MemoryTag tag) const { return usage[static_cast<std::size_t>(tag)]; }
+
+    std::int64_t TotalLiveBytes() const {
+        std::int64_t total = 0;
+        for (const MemoryUsage& u : usage) total += u.liveBytes;
+        return total;
+    }
+};
+
+class MemoryAccounting {
+public:
+#if defined(ELECTRIC_DEVICES_MEMORY_ACCOUNTING) || defined(ELECTRIC_DEVICES_ALLOC_TRACKING)
+    static constexpr bool kEnabled = true;
+#else
+    static constexpr bool kEnabled = false;
+#endif
+
+private:
+    // Каждая подсистема — в своей кеш-линии, чтобы потоки, выделяющие
+    // в разных подсистемах, не мешали друг другу
+    struct alignas(64) Account {
+        std::atomic<std::int64_t> live{0};
+        std::atomic<std::int64_t> peak{0};
+    };
+
+    static Account* Accounts() {
+        static Account accounts[static_cast<std::size_t>(MemoryTag::Count)];
+        return accounts;
+    }
+
+    static MemoryTag& Current() {
+        static thread_local MemoryTag current = MemoryTag::Other;
+        return current;
+    }
+
+    friend class MemoryTagScope;
+
+public:
+    static MemoryTag CurrentTag() { return Current(); }
+
+    // Вызываются из подменённых operator new/delete
+    static void OnAllocate(MemoryTag tag, std::size_t size) {
+        Account& account = Accounts()[static_cast<std::size_t>(tag)];
+        std::int64_t live = account.live.fetch_add(static_cast<std::int64_t>(size), std::memory_order_relaxed) +
+                            static_cast<std::int64_t>(size);
+        std::int64_t peak = account.peak.load(std::memory_order_relaxed);
+        while (live > peak && !account.peak.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {
+        }
+    }
+
+    static void OnFree(MemoryTag tag, std::size_t size) {
+        Accounts()[static_cast<std::size_t>(tag)].live.fetch_sub(static_cast<std::int64_t>(size),
+                                                                  std::memory_order_relaxed);
+    }
+
+    static MemorySnapshot Snapshot() {
+        MemorySnapshot snapshot;
+        snapshot.tracked = kEnabled;
+        for (std::size_t i = 0; i < static_cast<std::size_t>(MemoryTag::Count); ++i) {
+            snapshot.usage[i].liveBytes = Accounts()[i].live.load(std::memory_order_relaxed);
+            snapshot.usage[i].peakBytes = Accounts()[i].peak.load(std::memory_order_relaxed);
+        }
+        return snapshot;
+    }
+};
+
+// --- Подсистема текущего потока на время жизни объекта ---
+class MemoryTagScope {
+private:
+    MemoryTag _previous;
+
+public:
+    explicit MemoryTagScope(MemoryTag tag) : _previous(MemoryAccounting::Current()) {
+        MemoryAccounting::Current() = tag;
+    }
+    ~MemoryTagScope() { MemoryAccounting::Current() = _previous; }
+
+    MemoryTagScope(const MemoryTagScope&) = delete;
+    MemoryTagScope& operator=(const MemoryTagScope&) = delete;
+};
@@ -0,0 +1,361 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "device_manager.h"
+#include "devices.h"
+#include "latency_histogram.h"
+#include "logger.h"
+#include "profiler.h"
+#include "sharded_counter.h"
+#include "telemetry_pipeline.h"
+
+// === Снимки метрик для внешнего мониторинга ===
+// Поток-владелец DeviceManager вызывает MetricsPublisher::Publish (например,
+// на каждом кадре панели или после пакета команд); читатель (HTTP-сервер
+// метрик) забирает последний готовый снимок и форматирует его сам. Обмен
+// идёт через тройной буфер: ни писатель, ни читатель не ждут друг друга,
+// поэтому опрос метрик никогда не тормозит DeviceManager
+
+// --- Тройной буфер: один писатель, один читатель, без блокировок ---
+// Писатель заполняет Back() и вызывает Publish(); читатель вызывает
+// Acquire() и читает Front(). Средний слот передаётся атомарным обменом
+// индекса; бит kFresh отмечает, что в нём ещё не прочитанные данные
+template <typename T>
+class TripleBuffer {
+private:
+    static constexpr unsigned kFresh = 4;
+
+    T _slots[3];
+    std::atomic<unsigned> _middle{1};
+    unsigned _back = 0;   // принадлежит писателю
+    unsigned _front = 2;  // принадлежит читателю
+
+public:
+    T& Back() { return _slots[_back]; }
+
+    void Publish() {
+        _back = _middle.exchange(_back | kFresh, std::memory_order_acq_rel) & 3;
+    }
+
+    // true — во Front() появился более свежий снимок
+    bool Acquire() {
+        if (!(_middle.load(std::memory_order_relaxed) & kFresh)) return false;
+        _front = _middle.exchange(_front, std::memory_order_acq_rel) & 3;
+        return true;
+    }
+
+    const T& Front() const { return _slots[_front]; }
+};
+
+struct MetricsSnapshot {
+    struct Group {
+        const char* name;
+        long long power;
+        std::size_t count;
+        std::size_t onCount;
+        DemandStats demand;
+    };
+
+    // Задержки операций из профилировщика (только при ELECTRIC_DEVICES_PROFILING)
+    struct Operation {
+        std::string name;
+        std::uint64_t count;
+        double sumSeconds;
+        double p50Seconds;
+        double p99Seconds;
+    };
+
+    bool valid = false;
+    std::chrono::steady_clock::time_point publishedAt;
+    long long totalPower = 0;
+    std::size_t deviceCount = 0;
+    std::size_t onCount = 0;
+    std::uint64_t version = 0;
+    std::size_t loggerQueueDepth = 0;
+    DemandStats demand;
+    double demandWindowSeconds = 0;
+    std::vector<Group> groups;
+    std::vector<Operation> operations;
+};
+
+class MetricsPublisher {
+private:
+    TripleBuffer<MetricsSnapshot> _buffer;
+    const TelemetryPipeline* _pipeline = nullptr;
+
+    // Экранирование значения метки по правилам текстового формата Prometheus
+    static void AppendLabel(std::string& out, const char* value) {
+        for (const char* c = value; *c; ++c) {
+            if (*c == '\\' || *c == '"') out += '\\';
+            if (*c == '\n') {
+                out += "\\n";
+                continue;
+            }
+            out += *c;
+        }
+    }
+
+    static void AppendNumber(std::string& out, double value) {
+        char buffer[32];
+        int length = std::snprintf(buffer, sizeof(buffer), "%.9g", value);
+        out.append(buffer, static_cast<std::size_t>(length));
+    }
+
+    static void AppendHeader(std::string& out, const char* name, const char* type, const char* help) {
+        out += "# HELP ";
+        out += name;
+        out += ' ';
+        out += help;
+        out += "\n# TYPE ";
+        out += name;
+        out += ' ';
+        out += type;
+        out += '\n';
+    }
+
+    // Гистограммы задержек читаются прямо при опросе: они рассчитаны на
+    // чтение из любого потока
+    static void RenderLatency(std::string& out) {
+        static const char* const quantiles[] = {"0.5", "0.9", "0.99", "0.999"};
+        static const double percentiles[] = {50, 90, 99, 99.9};
+        LatencySnapshot latency;
+        AppendHeader(out, "electric_devices_latency_seconds", "summary", "Control operation latency.");
+        for (std::size_t i = 0; i < static_cast<std::size_t>(LatencyOp::Count); ++i) {
+            const char* op = LatencyOpName(static_cast<LatencyOp>(i));
+            LatencyStats::Snapshot(static_cast<LatencyOp>(i), latency);
+            for (std::size_t q = 0; q < 4; ++q) {
+                out += "electric_devices_latency_seconds{operation=\"";
+                out += op;
+                out += "\",quantile=\"";
+                out += quantiles[q];
+                out += "\"} ";
+                AppendNumber(out, latency.PercentileNs(percentiles[q]) / 1e9);
+                out += '\n';
+            }
+            out += "electric_devices_latency_seconds_sum{operation=\"";
+            out += op;
+            out += "\"} ";
+            AppendNumber(out, latency.TotalNs() / 1e9);
+            out += "\nelectric_devices_latency_seconds_count{operation=\"";
+            out += op;
+            out += "\"} ";
+            AppendNumber(out, static_cast<double>(latency.count));
+            out += '\n';
+        }
+    }
+
+    // Счётчики стадий конвейера телеметрии; читаются прямо при опросе
+    void RenderPipeline(std::string& out) const {
+        using Stage = TelemetryPipeline::Stage;
+        TelemetryPipeline::StageStats stats[static_cast<std::size_t>(Stage::Count)];
+        for (std::size_t i = 0; i < static_cast<std::size_t>(Stage::Count); ++i) {
+            stats[i] = _pipeline->Stats(static_cast<Stage>(i));
+        }
+        auto series = [&](const char* name, const char* type, const char* help, auto value) {
+            AppendHeader(out, name, type, help);
+            for (std::size_t i = 0; i < static_cast<std::size_t>(Stage::Count); ++i) {
+                out += name;
+                out += "{stage=\"";
+                out += TelemetryPipeline::StageName(static_cast<Stage>(i));
+                out += "\"} ";
+                AppendNumber(out, value(stats[i]));
+                out += '\n';
+            }
+        };
+        using Stats = TelemetryPipeline::StageStats;
+        series("electric_devices_pipeline_items_in_total", "counter", "Items consumed by a pipeline stage.",
+               [](const Stats& st) { return static_cast<double>(st.itemsIn); });
+        series("electric_devices_pipeline_items_out_total", "counter", "Items produced by a pipeline stage.",
+               [](const Stats& st) { return static_cast<double>(st.itemsOut); });
+        series("electric_devices_pipeline_busy_seconds_total", "counter", "Time a pipeline stage spent working.",
+               [](const Stats& st) { return st.busySeconds; });
+        series("electric_devices_pipeline_stall_seconds_total", "counter",
+               "Time a pipeline stage waited for room downstream.", [](const Stats& st) { return st.stallSeconds; });
+        series("electric_devices_pipeline_queue_depth", "gauge", "Batches waiting in front of a pipeline stage.",
+               [](const Stats& st) { return static_cast<double>(st.queueDepth); });
+        AppendHeader(out, "electric_devices_pipeline_alerts_total", "counter", "Threshold alerts raised.");
+        out += "electric_devices_pipeline_alerts_total ";
+        AppendNumber(out, static_cast<double>(_pipeline->AlertCount()));
+        out += '\n';
+    }
+
+public:
+    // Конвейер, чьи стадии попадут в экспорт; задаётся до запуска сервера метрик
+    void SetPipeline(const TelemetryPipeline* pipeline) { _pipeline = pipeline; }
+
+    // Вызывается потоком-владельцем DeviceManager. Очередь логгера — число
+    // записей, накопленных BatchLogger до Commit (асинхронного логгера нет)
+    void Publish(const DeviceManager& manager, const BatchLogger* logger = nullptr) {
+        MetricsSnapshot& snapshot = _buffer.Back();
+        snapshot.valid = true;
+        snapshot.publishedAt = std::chrono::steady_clock::now();
+        snapshot.totalPower = manager.GetTotalPower();
+        snapshot.deviceCount = manager.GetDeviceCount();
+        snapshot.onCount = manager.GetOnCount();
+        snapshot.version = manager.GetVersion();
+        snapshot.loggerQueueDepth = logger ? logger->GetPendingCount() : 0;
+        snapshot.demand = manager.GetSiteDemand(snapshot.publishedAt);
+        snapshot.demandWindowSeconds = std::chrono::duration<double>(manager.GetDemandWindow()).count();
+        snapshot.groups.clear();
+        const std::vector<DeviceGroupStats>& groups = manager.GetGroups();
+        for (std::size_t i = 0; i < groups.size(); ++i) {
+            const DeviceGroupStats& group = groups[i];
+            snapshot.groups.push_back({group.name, group.power, group.count, group.onCount,
+                                       manager.GetGroupDemand(i, snapshot.publishedAt)});
+        }
+        snapshot.operations.clear();
+        if (Profiler::kEnabled) {
+            for (const Profiler::ZoneReport& zone : Profiler::Snapshot()) {
+                if (zone.kind != Profiler::Kind::Timer || zone.count == 0) continue;
+                snapshot.operations.push_back(
+                    {zone.name, zone.count, zone.totalNs / 1e9, zone.p50Ns / 1e9, zone.p99Ns / 1e9});
+            }
+        }
+        _buffer.Publish();
+    }
+
+    // --- Сторона читателя: вызывать только из одного потока ---
+
+    // Дописывает в out последний опубликованный снимок в формате Prometheus
+    void RenderPrometheus(std::string& out) {
+        _buffer.Acquire();
+        const MetricsSnapshot& s = _buffer.Front();
+        if (!s.valid) return;
+
+        AppendHeader(out, "electric_devices_power_watts", "gauge", "Current total power draw.");
+        out += "electric_devices_power_watts ";
+        AppendNumber(out, static_cast<double>(s.totalPower));
+        out += '\n';
+
+        AppendHeader(out, "electric_devices_devices", "gauge", "Number of devices.");
+        out += "electric_devices_devices ";
+        AppendNumber(out, static_cast<double>(s.deviceCount));
+        out += '\n';
+
+        AppendHeader(out, "electric_devices_devices_on", "gauge", "Number of devices switched on.");
+        out += "electric_devices_devices_on ";
+        AppendNumber(out, static_cast<double>(s.onCount));
+        out += '\n';
+
+        AppendHeader(out, "electric_devices_on_ratio", "gauge", "Share of devices switched on.");
+        out += "electric_devices_on_ratio ";
+        AppendNumber(out, s.deviceCount ? static_cast<double>(s.onCount) / static_cast<double>(s.deviceCount) : 0);
+        out += '\n';
+
+        AppendHeader(out, "electric_devices_group_power_watts", "gauge", "Power draw per device type.");
+        for (const MetricsSnapshot::Group& group : s.groups) {
+            out += "electric_devices_group_power_watts{group=\"";
+            AppendLabel(out, group.name);
+            out += "\"} ";
+            AppendNumber(out, static_cast<double>(group.power));
+            out += '\n';
+        }
+
+        AppendHeader(out, "electric_devices_group_devices", "gauge", "Devices per device type and state.");
+        for (const MetricsSnapshot::Group& group : s.groups) {
+            out += "electric_devices_group_devices{group=\"";
+            AppendLabel(out, group.name);
+            out += "\",state=\"on\"} ";
+            AppendNumber(out, static_cast<double>(group.onCount));
+            out += "\nelectric_devices_group_devices{group=\"";
+            AppendLabel(out, group.name);
+            out += "\",state=\"off\"} ";
+            AppendNumber(out, static_cast<double>(group.count - group.onCount));
+            out += '\n';
+        }
+
+        // Нагрузка в скользящем окне: пик выборок, среднее по времени и
+        // наибольшее среднее за время работы (по нему считают счёт)
+        static const char* const demandStats[] = {"peak", "mean", "peak_mean"};
+        auto demandValue = [](const DemandStats& demand, std::size_t stat) {
+            return stat == 0 ? static_cast<double>(demand.peak) : stat == 1 ? demand.mean : demand.peakMean;
+        };
+        AppendHeader(out, "electric_devices_demand_window_seconds", "gauge", "Length of the demand window.");
+        out += "electric_devices_demand_window_seconds ";
+        AppendNumber(out, s.demandWindowSeconds);
+        out += '\n';
+
+        AppendHeader(out, "electric_devices_demand_watts", "gauge", "Power demand over the sliding window.");
+        for (std::size_t stat = 0; stat < 3; ++stat) {
+            out += "electric_devices_demand_watts{stat=\"";
+            out += demandStats[stat];
+            out += "\"} ";
+            AppendNumber(out, demandValue(s.demand, stat));
+            out += '\n';
+        }
+
+        AppendHeader(out, "electric_devices_group_demand_watts", "gauge",
+                     "Power demand per device type over the sliding window.");
+        for (const MetricsSnapshot::Group& group : s.groups) {
+            for (std::size_t stat = 0; stat < 3; ++stat) {
+                out += "electric_devices_group_demand_watts{group=\"";
+                AppendLabel(out, group.name);
+                out += "\",stat=\"";
+                out += demandStats[stat];
+                out += "\"} ";
+                AppendNumber(out, demandValue(group.demand, stat));
+                out += '\n';
+            }
+        }
+
+        AppendHeader(out, "electric_devices_state_changes_total", "counter", "State version of the fleet.");
+        out += "electric_devices_state_changes_total ";
+        AppendNumber(out, static_cast<double>(s.version));
+        out += '\n';
+
+        AppendHeader(out, "electric_devices_logger_queue_depth", "gauge", "Log records waiting for commit.");
+        out += "electric_devices_logger_queue_depth ";
+        AppendNumber(out, static_cast<double>(s.loggerQueueDepth));
+        out += '\n';
+
+        AppendHeader(out, "electric_devices_snapshot_age_seconds", "gauge", "Age of the published snapshot.");
+        out += "electric_devices_snapshot_age_seconds ";
+        AppendNumber(out, std::chrono::duration<double>(std::chrono::steady_clock::now() - s.publishedAt).count());
+        out += '\n';
+
+        // Счётчики операций суммируются по потокам прямо при опросе
+        OperationalStats::Get().ForEach([&out](const char* name, const char* help, std::int64_t value) {
+            std::string metric = std::string("electric_devices_") + name;
+            AppendHeader(out, metric.c_str(), "counter", help);
+            out += metric;
+            out += ' ';
+            AppendNumber(out, static_cast<double>(value));
+            out += '\n';
+        });
+
+        if (LatencyStats::kEnabled) RenderLatency(out);
+        if (_pipeline) RenderPipeline(out);
+
+        if (s.operations.empty()) return;
+        AppendHeader(out, "electric_devices_operation_seconds", "summary", "Operation latency.");
+        for (const MetricsSnapshot::Operation& op : s.operations) {
+            const char* quantiles[] = {"0.5", "0.99"};
+            const double values[] = {op.p50Seconds, op.p99Seconds};
+            for (int q = 0; q < 2; ++q) {
+                out += "electric_devices_operation_seconds{operation=\"";
+                AppendLabel(out, op.name.c_str());
+                out += "\",quantile=\"";
+                out += quantiles[q];
+                out += "\"} ";
+                AppendNumber(out, values[q]);
+                out += '\n';
+            }
+            out += "electric_devices_operation_seconds_sum{operation=\"";
+            AppendLabel(out, op.name.c_str());
+            out += "\"} ";
+            AppendNumber(out, op.sumSeconds);
+            out += "\nelectric_devices_operation_seconds_count{operation=\"";
+            AppendLabel(out, op.name.c_str());
+            out += "\"} ";
+            AppendNumber(out, static_cast<double>(op.count));
+            out += '\n';
+        }
+    }
+};
@@ -0,0 +1,235 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+#ifndef _WIN32
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstring>
+#include <netinet/in.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#include "metrics.h"
+#include "sharded_counter.h"
+
+// === HTTP-сервер метрик ===
+// Крошечный сервер на epoll в отдельном потоке: слушает только 127.0.0.1,
+// на GET /metrics отдаёт последний снимок MetricsPublisher в текстовом
+// формате Prometheus, на остальное — 404. Соединение закрывается после
+// ответа. DeviceManager сервер не трогает вовсе, только снимки.
+// На Windows не поддерживается: Start возвращает false
+class MetricsServer {
+private:
+    static constexpr std::size_t kMaxRequestBytes = 8192;
+
+    MetricsPublisher& _publisher;
+    int _listenFd = -1;
+    int _wakeFd = -1;
+    int _epollFd = -1;
+    std::uint16_t _port = 0;
+    std::thread _thread;
+
+    struct Connection {
+        std::string request;
+        std::string response;
+        std::size_t sent = 0;
+    };
+
+#ifndef _WIN32
+    std::unordered_map<int, Connection> _connections;
+    std::string _body;
+
+    bool Fail(const char* what, std::string& error) {
+        error = what;
+        error += ": ";
+        error += std::strerror(errno);
+        Close();
+        return false;
+    }
+
+    void Close() {
+        if (_listenFd >= 0) ::close(_listenFd);
+        if (_wakeFd >= 0) ::close(_wakeFd);
+        if (_epollFd >= 0) ::close(_epollFd);
+        _listenFd = _wakeFd = _epollFd = -1;
+    }
+
+    void Drop(int fd) {
+        ::epoll_ctl(_epollFd, EPOLL_CTL_DEL, fd, nullptr);
+        ::close(fd);
+        _connections.erase(fd);
+    }
+
+    void BuildResponse(Connection& connection) {
+        bool metrics = connection.request.compare(0, 13, "GET /metrics ") == 0 ||
+                       connection.request.compare(0, 13, "GET /metrics?") == 0;
+        _body.clear();
+        if (metrics) {
+            OperationalStats::Get().metricsScrapes.Increment();
+            _publisher.RenderPrometheus(_body);
+        }
+        else _body = "not found\n";
+        connection.response = metrics ? "HTTP/1.1 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\n"
+                                       : "HTTP/1.1 404 Not Found\r\nContent-Type: text/plain\r\n";
+        connection.response += "Connection: close\r\nContent-Length: ";
+        connection.response += std::to_string(_body.size());
+        connection.response += "\r\n\r\n";
+        connection.response += _body;
+    }
+
+    void Accept() {
+        for (;;) {
+            int fd = ::accept4(_listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (fd < 0) return;
+            epoll_event event{};
+            event.events = EPOLLIN | EPOLLRDHUP;
+            event.data.fd = fd;
+            if (::epoll_ctl(_epollFd, EPOLL_CTL_ADD, fd, &event) != 0) {
+                ::close(fd);
+                continue;
+            }
+            _connections[fd];
+        }
+    }
+
+    // Пишет, сколько примет сокет; true — ответ отправлен целиком
+    bool Send(int fd, Connection& connection) {
+        while (connection.sent < connection.response.size()) {
+            ssize_t written = ::send(fd, connection.response.data() + connection.sent,
+                                     connection.response.size() - connection.sent, MSG_NOSIGNAL);
+            if (written < 0) return false;
+            connection.sent += static_cast<std::size_t>(written);
+        }
+        return true;
+    }
+
+    void Serve(int fd, std::uint32_t events) {
+        auto found = _connections.find(fd);
+        if (found == _connections.end()) return;
+        Connection& connection = found->second;
+
+        if (connection.response.empty()) {
+            char chunk[4096];
+            bool peerClosed = (events & EPOLLRDHUP) != 0;
+            for (;;) {
+                ssize_t read = ::recv(fd, chunk, sizeof(chunk), 0);
+                if (read > 0) {
+                    connection.request.append(chunk, static_cast<std::size_t>(read));
+                    // Предел проверяется на каждом куске: клиент, не дающий
+                    // сокету опустеть, иначе раздувал бы буфер и держал цикл
+                    if (connection.request.size() > kMaxRequestBytes) return Drop(fd);
+                    continue;
+                }
+                if (read == 0) peerClosed = true;
+                else if (errno != EAGAIN) return Drop(fd);
+                break;
+            }
+            if (connection.request.find("\r\n\r\n") == std::string::npos) {
+                if (peerClosed) Drop(fd);
+                return;
+            }
+            BuildResponse(connection);
+        }
+
+        if (Send(fd, connection)) return Drop(fd);
+        if (errno != EAGAIN) return Drop(fd);
+        // Сокет заполнен: дописываем, когда освободится
+        epoll_event event{};
+        event.events = EPOLLOUT | EPOLLRDHUP;
+        event.data.fd = fd;
+        ::epoll_ctl(_epollFd, EPOLL_CTL_MOD, fd, &event);
+    }
+
+    void Loop() {
+        epoll_event events[64];
+        for (;;) {
+            int ready = ::epoll_wait(_epollFd, events, 64, -1);
+            if (ready < 0 && errno == EINTR) continue;
+            if (ready < 0) return;
+            for (int i = 0; i < ready; ++i) {
+                int fd = events[i].data.fd;
+                if (fd == _wakeFd) {
+                    for (auto& connection : _connections) ::close(connection.first);
+                    _connections.clear();
+                    return;
+                }
+                if (fd == _listenFd) Accept();
+                else Serve(fd, events[i].events);
+            }
+        }
+    }
+#endif
+
+public:
+    MetricsServer(MetricsPublisher& publisher) : _publisher(publisher) {}
+
+    ~MetricsServer() { Stop(); }
+
+    MetricsServer(const MetricsServer&) = delete;
+    MetricsServer& operator=(const MetricsServer&) = delete;
+
+    // Запускает сервер на 127.0.0.1:port (0 — любой свободный порт).
+    // При ошибке возвращает false и описание в error
+    bool Start(std::uint16_t port, std::string& error) {
+#ifdef _WIN32
+        (void)port;
+        error = "metrics server is not supported on Windows";
+        return false;
+#else
+        if (_thread.joinable()) {
+            error = "metrics server is already running";
+            return false;
+        }
+        _listenFd = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (_listenFd < 0) return Fail("socket", error);
+        int reuse = 1;
+        ::setsockopt(_listenFd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(port);
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (::bind(_listenFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+            return Fail("bind", error);
+        }
+        if (::listen(_listenFd, 64) != 0) return Fail("listen", error);
+        socklen_t length = sizeof(address);
+        ::getsockname(_listenFd, reinterpret_cast<sockaddr*>(&address), &length);
+        _port = ntohs(address.sin_port);
+
+        _wakeFd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (_wakeFd < 0) return Fail("eventfd", error);
+        _epollFd = ::epoll_create1(EPOLL_CLOEXEC);
+        if (_epollFd < 0) return Fail("epoll_create1", error);
+        for (int fd : {_listenFd, _wakeFd}) {
+            epoll_event event{};
+            event.events = EPOLLIN;
+            event.data.fd = fd;
+            if (::epoll_ctl(_epollFd, EPOLL_CTL_ADD, fd, &event) != 0) return Fail("epoll_ctl", error);
+        }
+        _thread = std::thread([this] { Loop(); });
+        return true;
+#endif
+    }
+
+    void Stop() {
+#ifndef _WIN32
+        if (!_thread.joinable()) return;
+        std::uint64_t one = 1;
+        ssize_t written = ::write(_wakeFd, &one, sizeof(one));
+        (void)written;
+        _thread.join();
+        Close();
+#endif
+    }
+
+    std::uint16_t Port() const { return _port; }
+};
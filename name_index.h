@@ -0,0 +1,346 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "devices.h"
+#include "flat_name_map.h"
+#include "memory_accounting.h"
+
+// === Индекс имён устройств ===
+// Имена хранятся один раз (в парке миллионы устройств, но различных имён
+// немного), к каждому имени привязан список дескрипторов устройств.
+// Поверх различных имён строятся:
+//  - сжатое префиксное дерево (radix trie) для поиска по префиксу;
+//  - триграммный индекс для поиска по подстроке и нечёткого поиска.
+// Дерево перестраивается лениво при первом запросе после появления
+// новых имён; новые устройства с известными именами его не затрагивают.
+// Все виды поиска не различают регистр латиницы: дерево строится по
+// именам, сведённым к нижнему регистру
+class NameIndex {
+public:
+    using NameId = std::uint32_t;
+
+    // --- Дескрипторы устройств одного имени ---
+    struct HandleRange {
+        const DeviceHandle* first = nullptr;
+        const DeviceHandle* last = nullptr;
+
+        const DeviceHandle* begin() const { return first; }
+        const DeviceHandle* end() const { return last; }
+        std::size_t size() const { return static_cast<std::size_t>(last - first); }
+        bool empty() const { return first == last; }
+    };
+
+    // --- Результат нечёткого поиска ---
+    struct FuzzyMatch {
+        NameId id;
+        double score;  // коэффициент Дайса по триграммам, 0..1
+    };
+
+private:
+    // Узел дерева: метка ребра — отрезок одного из имён, дети лежат подряд,
+    // а имена поддерева образуют отрезок [lo, hi) в отсортированном порядке
+    struct TrieNode {
+        NameId labelName;
+        std::uint32_t labelOffset;
+        std::uint32_t labelLength;
+        std::uint32_t firstChild;
+        std::uint32_t childCount;
+        std::uint32_t lo;
+        std::uint32_t hi;
+    };
+
+    // payload слота _ids: дескриптор единственного устройства имени, чтобы
+    // точный поиск обходился строкой кеша слота. У имён с несколькими
+    // устройствами в payload взведён kListTag, а остальные биты — номер
+    // списка в _handleLists; у уникальных имён списков нет вовсе
+    static constexpr std::size_t kListTag = std::size_t(1) << (sizeof(std::size_t) * 8 - 1);
+
+    // deque не перемещает строки при росте, поэтому ключи _ids
+    // могут ссылаться на них напрямую
+    std::deque<std::string> _names;
+    std::vector<std::uint32_t> _gramCounts;
+    std::vector<std::vector<DeviceHandle>> _handleLists;
+    FlatNameMap _ids;
+    std::unordered_map<std::uint32_t, std::vector<NameId>> _trigrams;
+
+    // Кандидатов нечёткого поиска не больше этого: частые триграммы
+    // иначе тянут за собой заметную долю всех имён
+    static constexpr std::size_t kMaxFuzzyCandidates = 1 << 14;
+
+    mutable std::vector<NameId> _sorted;
+    mutable std::vector<TrieNode> _trie;
+    mutable bool _trieDirty = false;
+
+    static unsigned char Fold(char c) {
+        return static_cast<unsigned char>(c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c);
+    }
+
+    static std::uint32_t Trigram(std::string_view text, std::size_t pos) {
+        return (std::uint32_t(Fold(text[pos])) << 16) | (std::uint32_t(Fold(text[pos + 1])) << 8) |
+               std::uint32_t(Fold(text[pos + 2]));
+    }
+
+    // Различные триграммы текста в отсортированном порядке
+    static std::vector<std::uint32_t> Trigrams(std::string_view text) {
+        std::vector<std::uint32_t> grams;
+        for (std::size_t i = 0; i + 3 <= text.size(); ++i) grams.push_back(Trigram(text, i));
+        std::sort(grams.begin(), grams.end());
+        grams.erase(std::unique(grams.begin(), grams.end()), grams.end());
+        return grams;
+    }
+
+    // Порядок имён: без учёта регистра, при равенстве — по байтам
+    static bool LessFolded(std::string_view a, std::string_view b) {
+        bool less = std::lexicographical_compare(a.begin(), a.end(), b.begin(), b.end(),
+                                                 [](char x, char y) { return Fold(x) < Fold(y); });
+        bool greater = std::lexicographical_compare(b.begin(), b.end(), a.begin(), a.end(),
+                                                    [](char x, char y) { return Fold(x) < Fold(y); });
+        return less || (!greater && a < b);
+    }
+
+    static bool ContainsFolded(std::string_view haystack, std::string_view needle) {
+        return std::search(haystack.begin(), haystack.end(), needle.begin(), needle.end(),
+                           [](char a, char b) { return Fold(a) == Fold(b); }) != haystack.end();
+    }
+
+    std::string_view Label(const TrieNode& node) const {
+        return std::string_view(_names[node.labelName]).substr(node.labelOffset, node.labelLength);
+    }
+
+    // Строит узел для имён _sorted[lo, hi), у которых общие (без учёта
+    // регистра) первые depth байт
+    void BuildNode(std::uint32_t index, std::uint32_t lo, std::uint32_t hi, std::size_t depth) const {
+        const std::string& first = _names[_sorted[lo]];
+        const std::string& last = _names[_sorted[hi - 1]];
+        std::size_t common = depth;
+        while (common < first.size() && common < last.size() && Fold(first[common]) == Fold(last[common])) ++common;
+
+        _trie[index].labelName = _sorted[lo];
+        _trie[index].labelOffset = static_cast<std::uint32_t>(depth);
+        _trie[index].labelLength = static_cast<std::uint32_t>(common - depth);
+        _trie[index].lo = lo;
+        _trie[index].hi = hi;
+
+        // Имена, равные общему префиксу (их несколько, если они различаются
+        // только регистром), идут первыми и детей не образуют
+        std::uint32_t begin = lo;
+        while (begin < hi && _names[_sorted[begin]].size() == common) ++begin;
+
+        std::vector<std::pair<std::uint32_t, std::uint32_t>> groups;
+        for (std::uint32_t i = begin; i < hi;) {
+            unsigned char c = Fold(_names[_sorted[i]][common]);
+            std::uint32_t j = i + 1;
+            while (j < hi && Fold(_names[_sorted[j]][common]) == c) ++j;
+            groups.emplace_back(i, j);
+            i = j;
+        }
+
+        std::uint32_t firstChild = static_cast<std::uint32_t>(_trie.size());
+        _trie[index].firstChild = firstChild;
+        _trie[index].childCount = static_cast<std::uint32_t>(groups.size());
+        _trie.resize(_trie.size() + groups.size());
+        for (std::size_t g = 0; g < groups.size(); ++g) {
+            BuildNode(firstChild + static_cast<std::uint32_t>(g), groups[g].first, groups[g].second, common);
+        }
+    }
+
+    void RebuildTrie() const {
+        MemoryTagScope memory(MemoryTag::Indexes);
+        _sorted.resize(_names.size());
+        for (NameId id = 0; id < _names.size(); ++id) _sorted[id] = id;
+        std::sort(_sorted.begin(), _sorted.end(),
+                  [this](NameId a, NameId b) { return LessFolded(_names[a], _names[b]); });
+        _trie.clear();
+        if (!_sorted.empty()) {
+            _trie.resize(1);
+            BuildNode(0, 0, static_cast<std::uint32_t>(_sorted.size()), 0);
+        }
+        _trieDirty = false;
+    }
+
+public:
+    NameIndex() = default;
+    NameIndex(const NameIndex&) = delete;
+    NameIndex& operator=(const NameIndex&) = delete;
+
+    void Add(DeviceHandle handle, const std::string& name) {
+        std::size_t* single = nullptr;
+        NameId found = _ids.Find(name, single);
+        if (found != FlatNameMap::kNotFound) {
+            MemoryTagScope memory(MemoryTag::Indexes);
+            if (!(*single & kListTag)) {
+                _handleLists.push_back({*single});
+                *single = kListTag | (_handleLists.size() - 1);
+            }
+            _handleLists[*single & ~kListTag].push_back(handle);
+            return;
+        }
+        NameId id = static_cast<NameId>(_names.size());
+        {
+            MemoryTagScope memory(MemoryTag::Names);
+            _names.push_back(name);
+        }
+        MemoryTagScope memory(MemoryTag::Indexes);
+        _ids.Insert(_names.back(), id, handle);
+        std::vector<std::uint32_t> grams = Trigrams(name);
+        _gramCounts.push_back(static_cast<std::uint32_t>(grams.size()));
+        for (std::uint32_t gram : grams) _trigrams[gram].push_back(id);
+        _trieDirty = true;
+    }
+
+    static constexpr NameId kNoName = FlatNameMap::kNotFound;
+
+    // Точный поиск имени; kNoName, если такого имени нет
+    NameId Find(std::string_view name) const { return _ids.Find(name); }
+
+    // Устройства с точно таким именем; пусто, если их нет. Диапазон
+    // действителен до следующего Add
+    HandleRange FindHandles(std::string_view name) const {
+        const std::size_t* single = nullptr;
+        if (_ids.Find(name, single) == kNoName) return {};
+        if (!(*single & kListTag)) return {single, single + 1};
+        const std::vector<DeviceHandle>& handles = _handleLists[*single & ~kListTag];
+        return {handles.data(), handles.data() + handles.size()};
+    }
+
+    // Все имена в лексикографическом порядке без учёта регистра латиницы
+    const std::vector<NameId>& SortedNames() const {
+        if (_trieDirty) RebuildTrie();
+        return _sorted;
+    }
+
+    std::size_t NameCount() const { return _names.size(); }
+    const std::string& Name(NameId id) const { return _names[id]; }
+    // Устройства имени; диапазон действителен до следующего Add
+    HandleRange Handles(NameId id) const { return FindHandles(_names[id]); }
+
+    // Имена с данным префиксом (без учёта регистра латиницы) в порядке SortedNames
+    std::vector<NameId> FindPrefix(std::string_view prefix) const {
+        if (_trieDirty) RebuildTrie();
+        std::vector<NameId> result;
+        if (_trie.empty()) return result;
+
+        std::uint32_t node = 0;
+        std::size_t matched = 0;
+        while (true) {
+            std::string_view label = Label(_trie[node]);
+            std::size_t n = std::min(label.size(), prefix.size() - matched);
+            for (std::size_t i = 0; i < n; ++i) {
+                if (Fold(prefix[matched + i]) != Fold(label[i])) return result;
+            }
+            matched += n;
+            if (matched == prefix.size()) break;
+
+            const TrieNode& current = _trie[node];
+            std::uint32_t next = 0;
+            bool found = false;
+            for (std::uint32_t c = 0; c < current.childCount; ++c) {
+                std::uint32_t child = current.firstChild + c;
+                if (Fold(Label(_trie[child])[0]) == Fold(prefix[matched])) {
+                    next = child;
+                    found = true;
+                    break;
+                }
+            }
+            if (!found) return result;
+            node = next;
+        }
+        result.assign(_sorted.begin() + _trie[node].lo, _sorted.begin() + _trie[node].hi);
+        return result;
+    }
+
+    // Имена, содержащие подстроку (без учёта регистра латиницы)
+    std::vector<NameId> FindSubstring(std::string_view text) const {
+        std::vector<NameId> result;
+        if (text.size() < 3) {
+            for (NameId id = 0; id < _names.size(); ++id) {
+                if (ContainsFolded(_names[id], text)) result.push_back(id);
+            }
+            return result;
+        }
+
+        // Пересечение списков триграмм начиная с самого короткого
+        std::vector<const std::vector<NameId>*> lists;
+        for (std::uint32_t gram : Trigrams(text)) {
+            auto found = _trigrams.find(gram);
+            if (found == _trigrams.end()) return result;
+            lists.push_back(&found->second);
+        }
+        std::sort(lists.begin(), lists.end(),
+                  [](const std::vector<NameId>* a, const std::vector<NameId>* b) { return a->size() < b->size(); });
+        std::vector<NameId> candidates = *lists.front();
+        std::vector<NameId> narrowed;
+        for (std::size_t i = 1; i < lists.size() && !candidates.empty(); ++i) {
+            narrowed.clear();
+            std::set_intersection(candidates.begin(), candidates.end(), lists[i]->begin(), lists[i]->end(),
+                                  std::back_inserter(narrowed));
+            candidates.swap(narrowed);
+        }
+        for (NameId id : candidates) {
+            if (ContainsFolded(_names[id], text)) result.push_back(id);
+        }
+        return result;
+    }
+
+    // Нечёткий поиск: имена, разделяющие с запросом достаточно триграмм,
+    // по убыванию сходства. Имя со сходством не ниже minScore делит с
+    // запросом не меньше need триграмм, поэтому кандидаты берутся только
+    // из q - need + 1 самых коротких списков (q — триграмм в запросе), и не
+    // больше kMaxFuzzyCandidates: при одних лишь частых триграммах ответ
+    // приближённый. Сходство кандидата считается по его собственным триграммам
+    std::vector<FuzzyMatch> FindFuzzy(std::string_view text, std::size_t maxResults = 10,
+                                      double minScore = 0.3) const {
+        std::vector<FuzzyMatch> result;
+        std::vector<std::uint32_t> grams = Trigrams(text);
+        if (grams.empty()) return result;
+
+        static const std::vector<NameId> kNone;
+        std::vector<const std::vector<NameId>*> lists;
+        for (std::uint32_t gram : grams) {
+            auto found = _trigrams.find(gram);
+            lists.push_back(found == _trigrams.end() ? &kNone : &found->second);
+        }
+        std::sort(lists.begin(), lists.end(),
+                  [](const std::vector<NameId>* a, const std::vector<NameId>* b) { return a->size() < b->size(); });
+        // 2c / (q + g) >= s при g >= c даёт c >= s·q / (2 - s)
+        double score = std::min(std::max(minScore, 0.0), 1.0);
+        std::size_t need = static_cast<std::size_t>(std::ceil(score * grams.size() / (2.0 - score) - 1e-9));
+        need = std::min(std::max<std::size_t>(need, 1), grams.size());
+
+        std::vector<NameId> candidates;
+        for (std::size_t i = 0; i < grams.size() - need + 1 && candidates.size() < kMaxFuzzyCandidates; ++i) {
+            std::size_t take = std::min(lists[i]->size(), kMaxFuzzyCandidates - candidates.size());
+            candidates.insert(candidates.end(), lists[i]->begin(), lists[i]->begin() + static_cast<std::ptrdiff_t>(take));
+        }
+        std::sort(candidates.begin(), candidates.end());
+        candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+
+        std::vector<std::uint32_t> own;
+        for (NameId id : candidates) {
+            own = Trigrams(_names[id]);
+            std::size_t shared = 0;
+            for (std::size_t a = 0, b = 0; a < grams.size() && b < own.size();) {
+                if (grams[a] < own[b]) ++a;
+                else if (own[b] < grams[a]) ++b;
+                else ++shared, ++a, ++b;
+            }
+            double similarity = 2.0 * shared / static_cast<double>(grams.size() + _gramCounts[id]);
+            if (similarity >= minScore) result.push_back(FuzzyMatch{id, similarity});
+        }
+        std::sort(result.begin(), result.end(), [](const FuzzyMatch& a, const FuzzyMatch& b) {
+            return a.score != b.score ? a.score > b.score : a.id < b.id;
+        });
+        if (result.size() > maxResults) result.resize(maxResults);
+        return result;
+    }
+};
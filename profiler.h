@@ -0,0 +1,344 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// === Профилирование: таймеры областей и счётчики ===
+// Включается определением ELECTRIC_DEVICES_PROFILING (опция CMake
+// ELECTRIC_DEVICES_PROFILING); без него PROFILE_SCOPE и PROFILE_COUNT
+// разворачиваются в пустые операции.
+//
+//  - PROFILE_SCOPE("имя") замеряет время до конца текущего блока по
+//    счётчику тактов процессора, откалиброванному по steady_clock;
+//  - PROFILE_COUNT("имя", n) прибавляет n к счётчику.
+// Каждый поток пишет только в свои ячейки (без блокировок и общих кеш-
+// линий); Profiler::Snapshot суммирует ячейки всех потоков, включая уже
+// завершившиеся, и отдаёт отчёт, который печатается текстом или JSON
+
+// --- Часы ---
+// Счётчик тактов там, где он есть (x86), иначе steady_clock в наносекундах
+class CycleClock {
+public:
+    static std::uint64_t Now() {
+#if defined(_MSC_VER) || defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                              std::chrono::steady_clock::now().time_since_epoch())
+                                              .count());
+#endif
+    }
+
+    // Тактов в наносекунде; калибруется один раз за ~10 мс при первом вызове
+    static double TicksPerNanosecond() {
+        static const double ticksPerNs = [] {
+            using Steady = std::chrono::steady_clock;
+            auto start = Steady::now();
+            std::uint64_t startTicks = Now();
+            while (Steady::now() - start < std::chrono::milliseconds(10)) {
+            }
+            std::uint64_t ticks = Now() - startTicks;
+            double ns = static_cast<double>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(Steady::now() - start).count());
+            return ticks > 0 && ns > 0 ? static_cast<double>(ticks) / ns : 1.0;
+        }();
+        return ticksPerNs;
+    }
+
+    static double ToNanoseconds(std::uint64_t ticks) {
+        return static_cast<double>(ticks) / TicksPerNanosecond();
+    }
+};
+
+class Profiler {
+public:
+#ifdef ELECTRIC_DEVICES_PROFILING
+    static constexpr bool kEnabled = true;
+#else
+    static constexpr bool kEnabled = false;
+#endif
+
+    static constexpr std::size_t kMaxZones = 128;
+    // Корзина b гистограммы — длительности [2^(b-1), 2^b) тактов
+    static constexpr std::size_t kBuckets = 48;
+
+    enum class Kind { Timer, Counter };
+
+    // Сводка по одной метке после слияния потоков
+    struct ZoneReport {
+        std::string name;
+        Kind kind;
+        std::uint64_t count;  // вызовов области или приращений счётчика
+        std::uint64_t total;  // сумма приращений счётчика
+        double totalNs, minNs, maxNs, p50Ns, p99Ns;
+        std::uint64_t buckets[kBuckets];
+    };
+
+private:
+    // Ячейка одной метки в одном потоке. Пишет только поток-владелец,
+    // поэтому атомарность нужна лишь для чтения из Snapshot: relaxed-
+    // операции компилируются в обычные загрузки и сохранения
+    struct Slot {
+        std::atomic<std::uint64_t> count{0};
+        std::atomic<std::uint64_t> total{0};
+        std::atomic<std::uint64_t> min{UINT64_MAX};
+        std::atomic<std::uint64_t> max{0};
+        std::atomic<std::uint64_t> buckets[kBuckets] = {};
+
+        static void Bump(std::atomic<std::uint64_t>& cell, std::uint64_t delta) {
+            cell.store(cell.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+        }
+    };
+
+    struct ThreadSlots {
+        Slot slots[kMaxZones];
+    };
+
+    struct Registry {
+        std::mutex mutex;
+        std::vector<ThreadSlots*> live;
+        ThreadSlots retired;  // сумма по завершившимся потокам
+        const char* names[kMaxZones] = {};
+        Kind kinds[kMaxZones] = {};
+        std::atomic<std::size_t> zoneCount{0};
+    };
+
+    // Не разрушается: отчёт может сниматься из atexit после статических деструкторов
+    static Registry& GetRegistry() {
+        static Registry* registry = new Registry();
+        return *registry;
+    }
+
+    static void Merge(Slot& into, const Slot& from) {
+        Slot::Bump(into.count, from.count.load(std::memory_order_relaxed));
+        Slot::Bump(into.total, from.total.load(std::memory_order_relaxed));
+        into.min.store(std::min(into.min.load(std::memory_order_relaxed), from.min.load(std::memory_order_relaxed)),
+                       std::memory_order_relaxed);
+        into.max.store(std::max(into.max.load(std::memory_order_relaxed), from.max.load(std::memory_order_relaxed)),
+                       std::memory_order_relaxed);
+        for (std::size_t b = 0; b < kBuckets; ++b) {
+            Slot::Bump(into.buckets[b], from.buckets[b].load(std::memory_order_relaxed));
+        }
+    }
+
+    // Ячейки текущего потока регистрируются при первом обращении и при
+    // завершении потока сливаются в retired
+    class ThreadHandle {
+    private:
+        std::unique_ptr<ThreadSlots> _slots;
+
+    public:
+        ThreadHandle() : _slots(new ThreadSlots()) {
+            Registry& registry = GetRegistry();
+            std::lock_guard<std::mutex> lock(registry.mutex);
+            registry.live.push_back(_slots.get());
+        }
+
+        ~ThreadHandle() {
+            Registry& registry = GetRegistry();
+            std::lock_guard<std::mutex> lock(registry.mutex);
+            for (std::size_t z = 0; z < kMaxZones; ++z) Merge(registry.retired.slots[z], _slots->slots[z]);
+            registry.live.erase(std::find(registry.live.begin(), registry.live.end(), _slots.get()));
+        }
+
+        Slot& At(std::size_t zone) { return _slots->slots[zone]; }
+    };
+
+    static Slot& ThreadSlot(std::size_t zone) {
+        static thread_local ThreadHandle handle;
+        return handle.At(zone);
+    }
+
+    static double BucketUpperNs(std::size_t bucket) {
+        return CycleClock::ToNanoseconds(bucket >= 64 ? UINT64_MAX : (std::uint64_t(1) << bucket));
+    }
+
+    static double Percentile(const std::uint64_t* buckets, std::uint64_t count, double fraction) {
+        if (count == 0) return 0;
+        std::uint64_t rank = static_cast<std::uint64_t>(fraction * static_cast<double>(count - 1)) + 1;
+        std::uint64_t seen = 0;
+        for (std::size_t b = 0; b < kBuckets; ++b) {
+            seen += buckets[b];
+            if (seen >= rank) return BucketUpperNs(b);
+        }
+        return BucketUpperNs(kBuckets - 1);
+    }
+
+public:
+    // Регистрирует метку; одноимённые места вызова (перегрузки, экземпляры
+    // шаблонов) получают общий номер. kMaxZones — мест больше нет
+    static std::size_t RegisterZone(const char* name, Kind kind) {
+        Registry& registry = GetRegistry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        std::size_t zone = registry.zoneCount.load(std::memory_order_relaxed);
+        for (std::size_t z = 0; z < zone; ++z) {
+            if (registry.kinds[z] == kind && std::strcmp(registry.names[z], name) == 0) return z;
+        }
+        if (zone >= kMaxZones) return kMaxZones;
+        registry.names[zone] = name;
+        registry.kinds[zone] = kind;
+        registry.zoneCount.store(zone + 1, std::memory_order_release);
+        return zone;
+    }
+
+    static void RecordTicks(std::size_t zone, std::uint64_t ticks) {
+        if (zone >= kMaxZones) return;
+        Slot& slot = ThreadSlot(zone);
+        Slot::Bump(slot.count, 1);
+        Slot::Bump(slot.total, ticks);
+        if (ticks < slot.min.load(std::memory_order_relaxed)) slot.min.store(ticks, std::memory_order_relaxed);
+        if (ticks > slot.max.load(std::memory_order_relaxed)) slot.max.store(ticks, std::memory_order_relaxed);
+        std::size_t bucket = 0;
+        for (std::uint64_t rest = ticks; rest != 0 && bucket + 1 < kBuckets; rest >>= 1) ++bucket;
+        Slot::Bump(slot.buckets[bucket], 1);
+    }
+
+    static void AddCount(std::size_t zone, std::uint64_t delta) {
+        if (zone >= kMaxZones) return;
+        Slot& slot = ThreadSlot(zone);
+        Slot::Bump(slot.count, 1);
+        Slot::Bump(slot.total, delta);
+    }
+
+    // Сводка по всем меткам: суммы по живым и завершившимся потокам
+    static std::vector<ZoneReport> Snapshot() {
+        Registry& registry = GetRegistry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        std::size_t zones = registry.zoneCount.load(std::memory_order_acquire);
+        std::vector<ZoneReport> reports;
+        reports.reserve(zones);
+        for (std::size_t z = 0; z < zones; ++z) {
+            Slot merged;
+            Merge(merged, registry.retired.slots[z]);
+            for (ThreadSlots* thread : registry.live) Merge(merged, thread->slots[z]);
+
+            ZoneReport report{registry.names[z], registry.kinds[z], 0, 0, 0.0, 0.0, 0.0, 0.0, 0.0, {}};
+            report.count = merged.count.load(std::memory_order_relaxed);
+            report.total = merged.total.load(std::memory_order_relaxed);
+            for (std::size_t b = 0; b < kBuckets; ++b) report.buckets[b] = merged.buckets[b].load(std::memory_order_relaxed);
+            if (report.kind == Kind::Timer) {
+                report.totalNs = CycleClock::ToNanoseconds(report.total);
+                report.minNs = report.count ? CycleClock::ToNanoseconds(merged.min.load(std::memory_order_relaxed)) : 0;
+                report.maxNs = CycleClock::ToNanoseconds(merged.max.load(std::memory_order_relaxed));
+                // Граница корзины может превышать максимум: оценка не выходит за него
+                report.p50Ns = std::min(Percentile(report.buckets, report.count, 0.50), report.maxNs);
+                report.p99Ns = std::min(Percentile(report.buckets, report.count, 0.99), report.maxNs);
+            } else {
+                report.totalNs = report.minNs = report.maxNs = report.p50Ns = report.p99Ns = 0;
+            }
+            reports.push_back(report);
+        }
+        // Сначала самые дорогие области, счётчики — в конце
+        std::sort(reports.begin(), reports.end(), [](const ZoneReport& a, const ZoneReport& b) {
+            if (a.kind != b.kind) return a.kind == Kind::Timer;
+            return a.kind == Kind::Timer ? a.totalNs > b.totalNs : a.total > b.total;
+        });
+        return reports;
+    }
+
+    static void WriteText(std::FILE* out) {
+        if (!kEnabled) {
+            std::fprintf(out, "profiling is disabled\n");
+            return;
+        }
+        std::vector<ZoneReport> reports = Snapshot();
+        std::fprintf(out, "%-32s %12s %14s %12s %12s %12s %12s\n", "scope", "calls", "total ms", "mean ns",
+                     "p50 ns<=", "p99 ns<=", "max ns");
+        for (const ZoneReport& r : reports) {
+            if (r.kind != Kind::Timer) continue;
+            std::fprintf(out, "%-32s %12llu %14.3f %12.1f %12.0f %12.0f %12.0f\n", r.name.c_str(),
+                         static_cast<unsigned long long>(r.count), r.totalNs / 1e6,
+                         r.count ? r.totalNs / static_cast<double>(r.count) : 0.0, r.p50Ns, r.p99Ns, r.maxNs);
+        }
+        std::fprintf(out, "%-32s %12s %14s\n", "counter", "updates", "total");
+        for (const ZoneReport& r : reports) {
+            if (r.kind != Kind::Counter) continue;
+            std::fprintf(out, "%-32s %12llu %14llu\n", r.name.c_str(), static_cast<unsigned long long>(r.count),
+                         static_cast<unsigned long long>(r.total));
+        }
+    }
+
+    static void WriteJson(std::FILE* out) {
+        std::vector<ZoneReport> reports = kEnabled ? Snapshot() : std::vector<ZoneReport>();
+        std::fprintf(out, "{\n  \"enabled\": %s,\n  \"ticks_per_ns\": %.4f,\n  \"scopes\": [",
+                     kEnabled ? "true" : "false", kEnabled ? CycleClock::TicksPerNanosecond() : 0.0);
+        const char* separator = "\n";
+        for (const ZoneReport& r : reports) {
+            if (r.kind != Kind::Timer) continue;
+            std::fprintf(out,
+                         "%s    {\"name\": \"%s\", \"calls\": %llu, \"total_ns\": %.0f, \"min_ns\": %.1f, "
+                         "\"max_ns\": %.1f, \"p50_ns\": %.0f, \"p99_ns\": %.0f, \"log2_tick_buckets\": [",
+                         separator, r.name.c_str(), static_cast<unsigned long long>(r.count), r.totalNs, r.minNs,
+                         r.maxNs, r.p50Ns, r.p99Ns);
+            std::size_t last = kBuckets;
+            while (last > 0 && r.buckets[last - 1] == 0) --last;
+            for (std::size_t b = 0; b < last; ++b) {
+                std::fprintf(out, "%s%llu", b ? ", " : "", static_cast<unsigned long long>(r.buckets[b]));
+            }
+            std::fprintf(out, "]}");
+            separator = ",\n";
+        }
+        std::fprintf(out, "\n  ],\n  \"counters\": [");
+        separator = "\n";
+        for (const ZoneReport& r : reports) {
+            if (r.kind != Kind::Counter) continue;
+            std::fprintf(out, "%s    {\"name\": \"%s\", \"updates\": %llu, \"total\": %llu}", separator,
+                         r.name.c_str(), static_cast<unsigned long long>(r.count),
+                         static_cast<unsigned long long>(r.total));
+            separator = ",\n";
+        }
+        std::fprintf(out, "\n  ]\n}\n");
+    }
+};
+
+// --- Метка: номер выдаётся один раз при первом проходе через место вызова ---
+struct ProfileZone {
+    std::size_t id;
+    ProfileZone(const char* name, Profiler::Kind kind) : id(Profiler::RegisterZone(name, kind)) {}
+};
+
+// --- Таймер области ---
+class ProfileScope {
+private:
+    std::size_t _zone;
+    std::uint64_t _start;
+
+public:
+    explicit ProfileScope(const ProfileZone& zone) : _zone(zone.id), _start(CycleClock::Now()) {}
+    ~ProfileScope() { Profiler::RecordTicks(_zone, CycleClock::Now() - _start); }
+
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+
+#ifdef ELECTRIC_DEVICES_PROFILING
+#define PROFILE_SCOPE(zoneName)                                                                 \
+    static const ProfileZone PROFILE_CONCAT(profileZone_, __LINE__){zoneName, Profiler::Kind::Timer}; \
+    ProfileScope PROFILE_CONCAT(profileScope_, __LINE__)(PROFILE_CONCAT(profileZone_, __LINE__))
+#define PROFILE_COUNT(zoneName, delta)                                                                    \
+    do {                                                                                                  \
+        static const ProfileZone profileCounterZone{zoneName, Profiler::Kind::Counter};                   \
+        Profiler::AddCount(profileCounterZone.id, static_cast<std::uint64_t>(delta));                     \
+    } while (0)
+#else
+#define PROFILE_SCOPE(zoneName) ((void)0)
+#define PROFILE_COUNT(zoneName, delta) ((void)0)
+#endif
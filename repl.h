@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+#include "command_processor.h"
+#include "console_ui.h"
+#include "device_manager.h"
+#include "logger.h"
+
+// === Интерактивная консоль (REPL) ===
+// Всё, что пришло на вход одним куском (например, вставленный скрипт из
+// многих строк), выполняется одним пакетом: переключения применяются
+// пакетно, в лог уходит одна сводная запись, вывод — одним write
+class Repl {
+private:
+    // Сколько ждать продолжения вставленного текста после первой строки
+    static constexpr int kPasteGraceMs = 5;
+    static constexpr std::size_t kReadBytes = 64 * 1024;
+
+    std::shared_ptr<BatchLogger> _logger;
+    CommandProcessor _processor;
+    int _inFd;
+    int _outFd;
+    std::function<void()> _afterBatch;
+
+    // Читает доступные данные; возвращает false на конце ввода
+    bool ReadAvailable(std::string& buffer) {
+        char chunk[kReadBytes];
+#ifdef _WIN32
+        int read = _read(_inFd, chunk, sizeof(chunk));
+        if (read <= 0) return false;
+        buffer.append(chunk, static_cast<std::size_t>(read));
+#else
+        ssize_t read = ::read(_inFd, chunk, sizeof(chunk));
+        if (read <= 0) return false;
+        buffer.append(chunk, static_cast<std::size_t>(read));
+        // Терминал отдаёт вставку построчно: добираем строки, пришедшие следом
+        pollfd pending{_inFd, POLLIN, 0};
+        while (::poll(&pending, 1, kPasteGraceMs) > 0 && (pending.revents & POLLIN)) {
+            read = ::read(_inFd, chunk, sizeof(chunk));
+            if (read <= 0) break;
+            buffer.append(chunk, static_cast<std::size_t>(read));
+        }
+#endif
+        return true;
+    }
+
+    void Prompt() const { WriteAll(_outFd, "> ", 2); }
+
+public:
+    Repl(DeviceManager& manager, std::shared_ptr<BatchLogger> logger, int inFd = 0, int outFd = 1)
+        : _logger(logger), _processor(manager, outFd), _inFd(inFd), _outFd(outFd) {}
+
+    // Вызывается после каждого выполненного пакета (например, для публикации метрик)
+    void SetBatchHook(std::function<void()> hook) { _afterBatch = std::move(hook); }
+
+    void Run() {
+        std::string input;
+        std::string& out = _processor.Output();
+        out += "Введите help для списка команд, quit для выхода\n";
+        WriteAll(_outFd, out.data(), out.size());
+        out.clear();
+
+        Prompt();
+        while (!_processor.IsQuitRequested()) {
+            bool eof = !ReadAvailable(input);
+            if (eof && !input.empty() && input.back() != '\n') input += '\n';
+
+            std::size_t executedBefore = _processor.GetExecutedCount();
+            std::size_t consumed = _processor.ExecuteBlock(input);
+            input.erase(0, consumed);
+
+            std::size_t executed = _processor.GetExecutedCount() - executedBefore;
+            if (executed > 0) _logger->Commit("Пакет из " + std::to_string(executed) + " команд");
+            if (executed > 0 && _afterBatch) _afterBatch();
+
+            if (!eof && !_processor.IsQuitRequested()) out += "> ";
+            std::cout.flush();
+            WriteAll(_outFd, out.data(), out.size());
+            out.clear();
+            if (eof) break;
+        }
+    }
+};
@@ -0,0 +1,315 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <vector>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+inline int PopCount64(std::uint64_t word) {
+#ifdef _MSC_VER
+    return static_cast<int>(__popcnt64(word));
+#else
+    return __builtin_popcountll(word);
+#endif
+}
+
+inline int CountTrailingZeros64(std::uint64_t word) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward64(&index, word);
+    return static_cast<int>(index);
+#else
+    return __builtin_ctzll(word);
+#endif
+}
+
+// === Сжатое битовое множество в стиле Roaring ===
+// 32-битные номера делятся по старшим 16 битам на контейнеры. Разреженный
+// контейнер хранит отсортированный массив младших 16 бит (до 4096
+// элементов), плотный — битовую карту на 65536 бит. Операции AND/OR/ANDNOT
+// выполняются контейнер за контейнером с выбором алгоритма по видам
+class RoaringBitmap {
+private:
+    static constexpr std::size_t kArrayMax = 4096;
+    static constexpr std::size_t kWords = 65536 / 64;
+
+    struct Container {
+        std::uint16_t key = 0;
+        std::uint32_t cardinality = 0;
+        std::vector<std::uint16_t> array;  // разреженный вид
+        std::vector<std::uint64_t> bits;   // плотный вид (kWords слов)
+
+        bool IsBitmap() const { return !bits.empty(); }
+
+        bool Contains(std::uint16_t low) const {
+            if (IsBitmap()) return (bits[low >> 6] >> (low & 63)) & 1;
+            return std::binary_search(array.begin(), array.end(), low);
+        }
+
+        void ToBitmap() {
+            bits.assign(kWords, 0);
+            for (std::uint16_t low : array) bits[low >> 6] |= std::uint64_t(1) << (low & 63);
+            array.clear();
+            array.shrink_to_fit();
+        }
+
+        void ToArray() {
+            array.clear();
+            array.reserve(cardinality);
+            ForEach([this](std::uint16_t low) { array.push_back(low); });
+            bits.clear();
+            bits.shrink_to_fit();
+        }
+
+        // Приводит вид контейнера к его мощности
+        void Normalize() {
+            if (IsBitmap() && cardinality <= kArrayMax) ToArray();
+            else if (!IsBitmap() && cardinality > kArrayMax) ToBitmap();
+        }
+
+        template <typename Fn>
+        void ForEach(Fn&& fn) const {
+            if (!IsBitmap()) {
+                for (std::uint16_t low : array) fn(low);
+                return;
+            }
+            for (std::size_t w = 0; w < kWords; ++w) {
+                for (std::uint64_t word = bits[w]; word; word &= word - 1) {
+                    fn(static_cast<std::uint16_t>(w * 64 + CountTrailingZeros64(word)));
+                }
+            }
+        }
+    };
+
+    std::vector<Container> _containers;  // по возрастанию key
+
+    std::vector<Container>::iterator Lower(std::uint16_t key) {
+        return std::lower_bound(_containers.begin(), _containers.end(), key,
+                                [](const Container& c, std::uint16_t k) { return c.key < k; });
+    }
+
+    std::vector<Container>::const_iterator Lower(std::uint16_t key) const {
+        return std::lower_bound(_containers.begin(), _containers.end(), key,
+                                [](const Container& c, std::uint16_t k) { return c.key < k; });
+    }
+
+    enum class Op { And, Or, AndNot };
+
+    static Container Combine(const Container& a, const Container& b, Op op) {
+        Container out;
+        out.key = a.key;
+        if (a.IsBitmap() && b.IsBitmap()) {
+            out.bits.resize(kWords);
+            std::uint32_t count = 0;
+            for (std::size_t w = 0; w < kWords; ++w) {
+                std::uint64_t word = op == Op::And ? a.bits[w] & b.bits[w]
+                                   : op == Op::Or  ? a.bits[w] | b.bits[w]
+                                                   : a.bits[w] & ~b.bits[w];
+                out.bits[w] = word;
+                count += PopCount64(word);
+            }
+            out.cardinality = count;
+        } else if (!a.IsBitmap() && !b.IsBitmap()) {
+            if (op == Op::And) {
+                std::set_intersection(a.array.begin(), a.array.end(), b.array.begin(), b.array.end(),
+                                      std::back_inserter(out.array));
+            } else if (op == Op::Or) {
+                std::set_union(a.array.begin(), a.array.end(), b.array.begin(), b.array.end(),
+                               std::back_inserter(out.array));
+            } else {
+                std::set_difference(a.array.begin(), a.array.end(), b.array.begin(), b.array.end(),
+                                    std::back_inserter(out.array));
+            }
+            out.cardinality = static_cast<std::uint32_t>(out.array.size());
+        } else if (op == Op::Or) {
+            // Массив вливается в копию битовой карты
+            const Container& dense = a.IsBitmap() ? a : b;
+            const Container& sparse = a.IsBitmap() ? b : a;
+            out.bits = dense.bits;
+            out.cardinality = dense.cardinality;
+            for (std::uint16_t low : sparse.array) {
+                std::uint64_t mask = std::uint64_t(1) << (low & 63);
+                if (!(out.bits[low >> 6] & mask)) {
+                    out.bits[low >> 6] |= mask;
+                    ++out.cardinality;
+                }
+            }
+        } else if (!a.IsBitmap()) {
+            // Массив фильтруется по битовой карте
+            bool keepIfPresent = op == Op::And;
+            for (std::uint16_t low : a.array) {
+                if (b.Contains(low) == keepIfPresent) out.array.push_back(low);
+            }
+            out.cardinality = static_cast<std::uint32_t>(out.array.size());
+        } else if (op == Op::And) {
+            for (std::uint16_t low : b.array) {
+                if (a.Contains(low)) out.array.push_back(low);
+            }
+            out.cardinality = static_cast<std::uint32_t>(out.array.size());
+        } else {
+            out.bits = a.bits;
+            out.cardinality = a.cardinality;
+            for (std::uint16_t low : b.array) {
+                std::uint64_t mask = std::uint64_t(1) << (low & 63);
+                if (out.bits[low >> 6] & mask) {
+                    out.bits[low >> 6] &= ~mask;
+                    --out.cardinality;
+                }
+            }
+        }
+        out.Normalize();
+        return out;
+    }
+
+    static RoaringBitmap Merge(const RoaringBitmap& a, const RoaringBitmap& b, Op op) {
+        RoaringBitmap result;
+        auto i = a._containers.begin();
+        auto j = b._containers.begin();
+        while (i != a._containers.end() || j != b._containers.end()) {
+            bool takeA = j == b._containers.end() || (i != a._containers.end() && i->key < j->key);
+            bool takeB = i == a._containers.end() || (j != b._containers.end() && j->key < i->key);
+            if (takeA) {
+                if (op != Op::And) result._containers.push_back(*i);
+                ++i;
+            } else if (takeB) {
+                if (op == Op::Or) result._containers.push_back(*j);
+                ++j;
+            } else {
+                Container combined = Combine(*i, *j, op);
+                if (combined.cardinality > 0) result._containers.push_back(std::move(combined));
+                ++i;
+                ++j;
+            }
+        }
+        return result;
+    }
+
+public:
+    void Add(std::uint32_t value) {
+        std::uint16_t key = static_cast<std::uint16_t>(value >> 16);
+        std::uint16_t low = static_cast<std::uint16_t>(value);
+        auto it = Lower(key);
+        if (it == _containers.end() || it->key != key) {
+            it = _containers.insert(it, Container{});
+            it->key = key;
+        }
+        if (it->IsBitmap()) {
+            std::uint64_t mask = std::uint64_t(1) << (low & 63);
+            if (it->bits[low >> 6] & mask) return;
+            it->bits[low >> 6] |= mask;
+        } else {
+            auto pos = std::lower_bound(it->array.begin(), it->array.end(), low);
+            if (pos != it->array.end() && *pos == low) return;
+            it->array.insert(pos, low);
+        }
+        ++it->cardinality;
+        it->Normalize();
+    }
+
+    void Remove(std::uint32_t value) {
+        std::uint16_t key = static_cast<std::uint16_t>(value >> 16);
+        std::uint16_t low = static_cast<std::uint16_t>(value);
+        auto it = Lower(key);
+        if (it == _containers.end() || it->key != key) return;
+        if (it->IsBitmap()) {
+            std::uint64_t mask = std::uint64_t(1) << (low & 63);
+            if (!(it->bits[low >> 6] & mask)) return;
+            it->bits[low >> 6] &= ~mask;
+        } else {
+            auto pos = std::lower_bound(it->array.begin(), it->array.end(), low);
+            if (pos == it->array.end() || *pos != low) return;
+            it->array.erase(pos);
+        }
+        if (--it->cardinality == 0) _containers.erase(it);
+        else it->Normalize();
+    }
+
+    bool Contains(std::uint32_t value) const {
+        std::uint16_t key = static_cast<std::uint16_t>(value >> 16);
+        auto it = Lower(key);
+        return it != _containers.end() && it->key == key && it->Contains(static_cast<std::uint16_t>(value));
+    }
+
+    std::size_t Cardinality() const {
+        std::size_t total = 0;
+        for (const Container& c : _containers) total += c.cardinality;
+        return total;
+    }
+
+    bool Empty() const { return _containers.empty(); }
+
+    // Обход элементов по возрастанию
+    template <typename Fn>
+    void ForEach(Fn&& fn) const {
+        for (const Container& c : _containers) {
+            std::uint32_t high = std::uint32_t(c.key) << 16;
+            c.ForEach([&](std::uint16_t low) { fn(high | low); });
+        }
+    }
+
+    std::vector<std::uint32_t> ToVector() const {
+        std::vector<std::uint32_t> values;
+        values.reserve(Cardinality());
+        ForEach([&](std::uint32_t v) { values.push_back(v); });
+        return values;
+    }
+
+    // Обход элементов не меньше start, пока fn возвращает true
+    template <typename Fn>
+    void ForEachFrom(std::uint32_t start, Fn&& fn) const {
+        for (auto it = Lower(static_cast<std::uint16_t>(start >> 16)); it != _containers.end(); ++it) {
+            std::uint32_t high = std::uint32_t(it->key) << 16;
+            bool stop = false;
+            it->ForEach([&](std::uint16_t low) {
+                std::uint32_t value = high | low;
+                if (stop || value < start) return;
+                stop = !fn(value);
+            });
+            if (stop) return;
+        }
+    }
+
+    // Множество по готовой битовой карте: бит i слова w означает число w * 64 + i.
+    // Так результат поколоночного сравнения превращается в множество без поэлементных Add
+    static RoaringBitmap FromWords(const std::vector<std::uint64_t>& words) {
+        RoaringBitmap result;
+        for (std::size_t first = 0; first < words.size(); first += kWords) {
+            std::size_t last = std::min(words.size(), first + kWords);
+            std::uint32_t count = 0;
+            for (std::size_t w = first; w < last; ++w) count += PopCount64(words[w]);
+            if (count == 0) continue;
+            Container c;
+            c.key = static_cast<std::uint16_t>(first / kWords);
+            c.cardinality = count;
+            c.bits.assign(kWords, 0);
+            std::copy(words.begin() + first, words.begin() + last, c.bits.begin());
+            c.Normalize();
+            result._containers.push_back(std::move(c));
+        }
+        return result;
+    }
+
+    // Множество [0, count): например, «все устройства»
+    static RoaringBitmap Range(std::uint32_t count) {
+        RoaringBitmap result;
+        for (std::uint32_t start = 0; start < count; start += 65536) {
+            Container c;
+            c.key = static_cast<std::uint16_t>(start >> 16);
+            c.cardinality = std::min<std::uint32_t>(65536, count - start);
+            c.bits.assign(kWords, 0);
+            for (std::uint32_t i = 0; i < c.cardinality; ++i) c.bits[i >> 6] |= std::uint64_t(1) << (i & 63);
+            c.Normalize();
+            result._containers.push_back(std::move(c));
+        }
+        return result;
+    }
+
+    friend RoaringBitmap operator&(const RoaringBitmap& a, const RoaringBitmap& b) { return Merge(a, b, Op::And); }
+    friend RoaringBitmap operator|(const RoaringBitmap& a, const RoaringBitmap& b) { return Merge(a, b, Op::Or); }
+    friend RoaringBitmap operator-(const RoaringBitmap& a, const RoaringBitmap& b) { return Merge(a, b, Op::AndNot); }
+};
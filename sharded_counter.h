@@ -0,0 +1,140 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// === Счётчики без разделения кеш-линий между потоками ===
+// Каждый поток при первом обращении занимает один из kSlots номеров и
+// пишет только в свою ячейку; ячейки выровнены по кеш-линии, поэтому
+// потоки не перебрасывают линии друг другу. Владелец ячейки обновляет её
+// обычной загрузкой и сохранением (relaxed), без атомарного
+// read-modify-write. Value() суммирует ячейки при чтении.
+// Номер освобождается при завершении потока, а значение остаётся в
+// ячейке: следующий поток с тем же номером продолжает с него, и сумма не
+// теряется. Если живых потоков больше kSlots, лишние пишут в общую ячейку
+// через fetch_add
+
+class CounterSlots {
+public:
+    static constexpr int kSlots = 64;
+    static constexpr int kOverflow = -1;
+
+private:
+    static std::atomic<std::uint64_t>& Used() {
+        static std::atomic<std::uint64_t> used{0};
+        return used;
+    }
+
+    static int Claim() {
+        std::uint64_t used = Used().load(std::memory_order_relaxed);
+        for (;;) {
+            if (~used == 0) return kOverflow;
+            int slot = 0;
+            while (used & (std::uint64_t(1) << slot)) ++slot;
+            if (Used().compare_exchange_weak(used, used | (std::uint64_t(1) << slot), std::memory_order_acquire)) {
+                return slot;
+            }
+        }
+    }
+
+    // Освобождение с release: последние записи потока в его ячейки видны
+    // тому, кто займёт номер следующим (захват — с acquire). Счётчики,
+    // тронутые из более поздних деструкторов потока (например, operator
+    // delete), пишут уже в общую ячейку
+    struct Holder {
+        int slot = Claim();
+        ~Holder() {
+            Cached() = kOverflow;
+            if (slot != kOverflow) Used().fetch_and(~(std::uint64_t(1) << slot), std::memory_order_release);
+        }
+    };
+
+    // -2 — ещё не занят; константная инициализация не требует проверок
+    static int& Cached() {
+        static thread_local int slot = -2;
+        return slot;
+    }
+
+    static int Register() {
+        static thread_local Holder holder;
+        return holder.slot;
+    }
+
+public:
+    static int Current() {
+        int& slot = Cached();
+        if (slot == -2) slot = Register();
+        return slot;
+    }
+};
+
+class ShardedCounter {
+private:
+    struct alignas(64) Cell {
+        std::atomic<std::int64_t> value{0};
+    };
+
+    Cell _cells[CounterSlots::kSlots];
+    Cell _overflow;
+
+public:
+    ShardedCounter() = default;
+    ShardedCounter(const ShardedCounter&) = delete;
+    ShardedCounter& operator=(const ShardedCounter&) = delete;
+
+    void Add(std::int64_t delta) {
+        int slot = CounterSlots::Current();
+        if (slot == CounterSlots::kOverflow) {
+            _overflow.value.fetch_add(delta, std::memory_order_relaxed);
+            return;
+        }
+        std::atomic<std::int64_t>& cell = _cells[slot].value;
+        cell.store(cell.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+    }
+
+    void Increment() { Add(1); }
+
+    // Сумма по всем потокам; при параллельной записи — значение на момент
+    // где-то между началом и концом обхода
+    std::int64_t Value() const {
+        std::int64_t total = _overflow.value.load(std::memory_order_relaxed);
+        for (const Cell& cell : _cells) total += cell.value.load(std::memory_order_relaxed);
+        return total;
+    }
+};
+
+// --- Рабочая статистика процесса ---
+// Общие счётчики операций; пишутся из любых потоков, читаются экспортом метрик
+struct OperationalStats {
+    ShardedCounter devicesAdded;
+    ShardedCounter devicesTurnedOn;
+    ShardedCounter devicesTurnedOff;
+    ShardedCounter messagesLogged;
+    ShardedCounter bytesLogged;
+    ShardedCounter bytesWritten;
+    ShardedCounter metricsScrapes;
+    ShardedCounter readingsReceived;
+    ShardedCounter readingsApplied;
+    ShardedCounter readingsRejected;
+
+    static OperationalStats& Get() {
+        static OperationalStats stats;
+        return stats;
+    }
+
+    // fn(имя, описание, значение) для каждого счётчика
+    template <typename Fn>
+    void ForEach(Fn&& fn) const {
+        fn("devices_added_total", "Devices added to the fleet.", devicesAdded.Value());
+        fn("devices_turned_on_total", "Devices switched on.", devicesTurnedOn.Value());
+        fn("devices_turned_off_total", "Devices switched off.", devicesTurnedOff.Value());
+        fn("log_messages_total", "Messages passed to log sinks.", messagesLogged.Value());
+        fn("log_bytes_total", "Bytes passed to log sinks.", bytesLogged.Value());
+        fn("console_bytes_written_total", "Bytes written by the console UI.", bytesWritten.Value());
+        fn("metrics_scrapes_total", "Metrics requests served.", metricsScrapes.Value());
+        fn("telemetry_readings_received_total", "Power readings received.", readingsReceived.Value());
+        fn("telemetry_readings_applied_total", "Power readings applied to devices.", readingsApplied.Value());
+        fn("telemetry_readings_rejected_total", "Malformed readings or unknown devices.", readingsRejected.Value());
+    }
+};
@@ -0,0 +1,260 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <string>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// === Итоги парка в разделяемой памяти ===
+// DeviceManager может публиковать суммарную мощность, счётчики и итоги по
+// типам в сегмент POSIX shm (см. DeviceManager::PublishTotalsTo). Сегмент
+// защищён seqlock: писатель делает счётчик последовательности нечётным,
+// пишет поля и делает его чётным; читатель копирует поля и повторяет, если
+// счётчик был нечётным или изменился. Чтение не делает системных вызовов
+// и не берёт блокировок, писатель никогда не ждёт читателей.
+// Поля — атомарные переменные без блокировок, поэтому одинаково работают
+// в любом процессе, отобразившем сегмент. На Windows не поддерживается
+
+struct SharedTotals {
+    static constexpr std::size_t kMaxGroups = 16;
+    static constexpr std::size_t kNameBytes = 32;
+
+    struct Group {
+        char name[kNameBytes];
+        long long power;
+        std::uint64_t count;
+        std::uint64_t onCount;
+    };
+
+    long long totalPower = 0;
+    std::uint64_t deviceCount = 0;
+    std::uint64_t onCount = 0;
+    std::uint64_t version = 0;
+    std::uint32_t groupCount = 0;
+    Group groups[kMaxGroups] = {};
+};
+
+namespace shared_totals_detail {
+
+constexpr std::uint64_t kMagic = 0x454C4543544F544Cull;  // "ELECTOTL"
+constexpr std::uint32_t kLayoutVersion = 1;
+
+// Раскладка сегмента; меняется только вместе с kLayoutVersion
+struct Layout {
+    std::uint64_t magic;
+    std::uint32_t layoutVersion;
+    alignas(64) std::atomic<std::uint64_t> sequence;
+    std::atomic<long long> totalPower;
+    std::atomic<std::uint64_t> deviceCount;
+    std::atomic<std::uint64_t> onCount;
+    std::atomic<std::uint64_t> version;
+    std::atomic<std::uint32_t> groupCount;
+    struct Group {
+        std::atomic<char> name[SharedTotals::kNameBytes];
+        std::atomic<long long> power;
+        std::atomic<std::uint64_t> count;
+        std::atomic<std::uint64_t> onCount;
+    } groups[SharedTotals::kMaxGroups];
+};
+
+static_assert(std::atomic<std::uint64_t>::is_always_lock_free, "shared totals need lock-free 64-bit atomics");
+
+}  // namespace shared_totals_detail
+
+// --- Писатель: создаёт сегмент и обновляет его ---
+class SharedTotalsPublisher {
+private:
+    using Layout = shared_totals_detail::Layout;
+
+    Layout* _layout = nullptr;
+    std::string _name;
+
+    template <typename T, typename V>
+    static void Put(std::atomic<T>& field, V value) {
+        field.store(static_cast<T>(value), std::memory_order_relaxed);
+    }
+
+public:
+    SharedTotalsPublisher() = default;
+    ~SharedTotalsPublisher() { Close(); }
+
+    SharedTotalsPublisher(const SharedTotalsPublisher&) = delete;
+    SharedTotalsPublisher& operator=(const SharedTotalsPublisher&) = delete;
+
+    // Создаёт (или пересоздаёт) сегмент name, например "/electric_totals".
+    // При ошибке возвращает false и описание в error
+    bool Open(const std::string& name, std::string& error) {
+#ifdef _WIN32
+        (void)name;
+        error = "shared memory totals are not supported on Windows";
+        return false;
+#else
+        Close();
+        int fd = ::shm_open(name.c_str(), O_CREAT | O_RDWR, 0644);
+        if (fd < 0) {
+            error = "shm_open: " + std::string(std::strerror(errno));
+            return false;
+        }
+        if (::ftruncate(fd, sizeof(Layout)) != 0) {
+            error = "ftruncate: " + std::string(std::strerror(errno));
+            ::close(fd);
+            return false;
+        }
+        void* memory = ::mmap(nullptr, sizeof(Layout), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (memory == MAP_FAILED) {
+            error = "mmap: " + std::string(std::strerror(errno));
+            return false;
+        }
+        // Пока магия не записана, читатели сегмент не принимают
+        _layout = new (memory) Layout();
+        _layout->layoutVersion = shared_totals_detail::kLayoutVersion;
+        std::atomic_thread_fence(std::memory_order_release);
+        _layout->magic = shared_totals_detail::kMagic;
+        _name = name;
+        return true;
+#endif
+    }
+
+    void Close() {
+#ifndef _WIN32
+        if (!_layout) return;
+        ::munmap(_layout, sizeof(Layout));
+        ::shm_unlink(_name.c_str());
+        _layout = nullptr;
+#endif
+    }
+
+    bool IsOpen() const { return _layout != nullptr; }
+
+    // Запись между BeginWrite и EndWrite читатели видят целиком или не видят
+    void BeginWrite() {
+        std::uint64_t sequence = _layout->sequence.load(std::memory_order_relaxed);
+        _layout->sequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+
+    void EndWrite() {
+        std::uint64_t sequence = _layout->sequence.load(std::memory_order_relaxed);
+        _layout->sequence.store(sequence + 1, std::memory_order_release);
+    }
+
+    void SetTotals(long long totalPower, std::uint64_t deviceCount, std::uint64_t onCount, std::uint64_t version) {
+        Put(_layout->totalPower, totalPower);
+        Put(_layout->deviceCount, deviceCount);
+        Put(_layout->onCount, onCount);
+        Put(_layout->version, version);
+    }
+
+    // Группы сверх kMaxGroups не публикуются
+    void SetGroup(std::size_t index, const char* name, long long power, std::uint64_t count, std::uint64_t onCount) {
+        if (index >= SharedTotals::kMaxGroups) return;
+        Layout::Group& group = _layout->groups[index];
+        if (name) {
+            std::size_t i = 0;
+            for (; i + 1 < SharedTotals::kNameBytes && name[i]; ++i) Put(group.name[i], name[i]);
+            for (; i < SharedTotals::kNameBytes; ++i) Put(group.name[i], '\0');
+        }
+        Put(group.power, power);
+        Put(group.count, count);
+        Put(group.onCount, onCount);
+        if (index >= _layout->groupCount.load(std::memory_order_relaxed)) Put(_layout->groupCount, index + 1);
+    }
+};
+
+// --- Читатель: отображает сегмент только для чтения ---
+class SharedTotalsReader {
+private:
+    using Layout = shared_totals_detail::Layout;
+
+    const Layout* _layout = nullptr;
+
+    template <typename T>
+    static T Get(const std::atomic<T>& field) {
+        return field.load(std::memory_order_relaxed);
+    }
+
+public:
+    SharedTotalsReader() = default;
+    ~SharedTotalsReader() { Close(); }
+
+    SharedTotalsReader(const SharedTotalsReader&) = delete;
+    SharedTotalsReader& operator=(const SharedTotalsReader&) = delete;
+
+    bool Open(const std::string& name, std::string& error) {
+#ifdef _WIN32
+        (void)name;
+        error = "shared memory totals are not supported on Windows";
+        return false;
+#else
+        Close();
+        int fd = ::shm_open(name.c_str(), O_RDONLY, 0);
+        if (fd < 0) {
+            error = "shm_open: " + std::string(std::strerror(errno));
+            return false;
+        }
+        // Писатель мог ещё не задать размер: обращение за концом файла дало бы SIGBUS
+        struct stat info {};
+        if (::fstat(fd, &info) != 0 || static_cast<std::size_t>(info.st_size) < sizeof(Layout)) {
+            error = "segment is not initialized yet";
+            ::close(fd);
+            return false;
+        }
+        void* memory = ::mmap(nullptr, sizeof(Layout), PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (memory == MAP_FAILED) {
+            error = "mmap: " + std::string(std::strerror(errno));
+            return false;
+        }
+        _layout = static_cast<const Layout*>(memory);
+        if (_layout->magic != shared_totals_detail::kMagic ||
+            _layout->layoutVersion != shared_totals_detail::kLayoutVersion) {
+            error = "segment has an unknown layout";
+            Close();
+            return false;
+        }
+        return true;
+#endif
+    }
+
+    void Close() {
+#ifndef _WIN32
+        if (!_layout) return;
+        ::munmap(const_cast<Layout*>(_layout), sizeof(Layout));
+        _layout = nullptr;
+#endif
+    }
+
+    // Согласованная копия итогов; повторяет чтение, пока писатель посередине записи
+    void Read(SharedTotals& out) const {
+        for (;;) {
+            std::uint64_t before = _layout->sequence.load(std::memory_order_acquire);
+            if (before & 1) continue;
+            out.totalPower = Get(_layout->totalPower);
+            out.deviceCount = Get(_layout->deviceCount);
+            out.onCount = Get(_layout->onCount);
+            out.version = Get(_layout->version);
+            out.groupCount = std::min<std::uint32_t>(Get(_layout->groupCount), SharedTotals::kMaxGroups);
+            for (std::uint32_t g = 0; g < out.groupCount; ++g) {
+                const Layout::Group& group = _layout->groups[g];
+                for (std::size_t i = 0; i < SharedTotals::kNameBytes; ++i) out.groups[g].name[i] = Get(group.name[i]);
+                out.groups[g].power = Get(group.power);
+                out.groups[g].count = Get(group.count);
+                out.groups[g].onCount = Get(group.onCount);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (_layout->sequence.load(std::memory_order_relaxed) == before) return;
+        }
+    }
+};
@@ -0,0 +1,157 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// === Сортировки для упорядоченных представлений устройств ===
+
+// Поразрядная сортировка LSD дескрипторов по 32-битным ключам: четыре
+// устойчивых прохода по байтам. Проход пропускается, если во всех ключах
+// байт одинаковый (типично для мощностей: старшие байты нулевые).
+// Результат — перестановка order, упорядочивающая keys по возрастанию
+inline void RadixSortByKey(const std::vector<std::int32_t>& keys, std::vector<std::uint32_t>& order) {
+    std::size_t count = keys.size();
+    std::vector<std::uint32_t> sortKeys(count);
+    order.resize(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        // Инверсия знакового бита сохраняет порядок для отрицательных значений
+        sortKeys[i] = static_cast<std::uint32_t>(keys[i]) ^ 0x80000000u;
+        order[i] = static_cast<std::uint32_t>(i);
+    }
+
+    std::vector<std::uint32_t> keyBuffer(count);
+    std::vector<std::uint32_t> orderBuffer(count);
+    for (unsigned shift = 0; shift < 32; shift += 8) {
+        std::size_t histogram[256] = {};
+        for (std::uint32_t key : sortKeys) ++histogram[(key >> shift) & 0xFF];
+        if (count == 0 || histogram[(sortKeys[0] >> shift) & 0xFF] == count) continue;
+
+        std::size_t offset = 0;
+        for (std::size_t& bucket : histogram) {
+            std::size_t size = bucket;
+            bucket = offset;
+            offset += size;
+        }
+        for (std::size_t i = 0; i < count; ++i) {
+            std::size_t pos = histogram[(sortKeys[i] >> shift) & 0xFF]++;
+            keyBuffer[pos] = sortKeys[i];
+            orderBuffer[pos] = order[i];
+        }
+        sortKeys.swap(keyBuffer);
+        order.swap(orderBuffer);
+    }
+}
+
+// Первые n дескрипторов по убыванию ключа (при равенстве — по возрастанию
+// дескриптора): nth_element отсекает остальные, сортируется только голова
+inline std::vector<std::uint32_t> TopByKey(const std::vector<std::int32_t>& keys, std::size_t n) {
+    std::vector<std::uint32_t> order(keys.size());
+    for (std::size_t i = 0; i < keys.size(); ++i) order[i] = static_cast<std::uint32_t>(i);
+    auto before = [&keys](std::uint32_t a, std::uint32_t b) {
+        return keys[a] != keys[b] ? keys[a] > keys[b] : a < b;
+    };
+    n = std::min(n, order.size());
+    if (n < order.size()) {
+        std::nth_element(order.begin(), order.begin() + n, order.end(), before);
+        order.resize(n);
+    }
+    std::sort(order.begin(), order.end(), before);
+    return order;
+}
+
+// --- Кешированная перестановка ---
+// Хранит перестановку и версию данных, по которым она построена;
+// перестраивается только если соответствующая версия сменилась
+struct SortedViewCache {
+    std::vector<std::uint32_t> order;
+    std::uint64_t version = 0;
+    bool valid = false;
+
+    bool IsFresh(std::uint64_t current) const { return valid && version == current; }
+
+    void MarkBuilt(std::uint64_t current) {
+        version = current;
+        valid = true;
+    }
+};
+
+// --- Инкрементальный отбор первых по ключу ---
+// Держит небольшое множество кандидатов, заведомо опережающих все
+// остальные дескрипторы: при перестроении берутся первые kSpare·n по
+// TopByKey, а последний из них становится границей. Изменение ключа
+// стоит O(кандидатов): дескриптор, обогнавший границу, добавляется,
+// кандидат, отставший от неё, выбывает. Полный проход по колонке нужен,
+// только когда кандидатов осталось меньше n, то есть после множества
+// понижений в голове списка
+class TopKeyTracker {
+private:
+    static constexpr std::size_t kSpare = 4;
+
+    std::size_t _n = 0;
+    std::vector<std::uint32_t> _candidates;
+    bool _bounded = false;  // у границы есть значение: за ней есть дескрипторы
+    std::int32_t _boundKey = 0;
+    std::uint32_t _boundHandle = 0;
+    bool _stale = true;
+
+    // a идёт раньше b: больший ключ, при равенстве — меньший дескриптор
+    static bool Ahead(std::int32_t keyA, std::uint32_t a, std::int32_t keyB, std::uint32_t b) {
+        return keyA != keyB ? keyA > keyB : a < b;
+    }
+
+    bool AheadOfBound(std::int32_t key, std::uint32_t handle) const {
+        return !_bounded || !Ahead(_boundKey, _boundHandle, key, handle);
+    }
+
+    void Rebuild(const std::vector<std::int32_t>& keys) {
+        std::size_t keep = _n * kSpare;
+        _candidates = TopByKey(keys, keep);
+        _bounded = _candidates.size() < keys.size();
+        if (_bounded) {
+            _boundHandle = _candidates.back();
+            _boundKey = keys[_boundHandle];
+        }
+        _candidates.reserve(keep * 2);
+        _stale = false;
+    }
+
+public:
+    // Сколько первых будут запрашивать; 0 — отбор не ведётся
+    void Track(std::size_t n) {
+        _n = n;
+        _candidates.clear();
+        _stale = true;
+    }
+
+    bool Covers(std::size_t n) const { return n > 0 && n <= _n; }
+
+    // Ключ handle стал key (новый дескриптор — тоже изменение)
+    void Update(std::uint32_t handle, std::int32_t key) {
+        if (_n == 0 || _stale) return;
+        auto found = std::find(_candidates.begin(), _candidates.end(), handle);
+        bool ahead = AheadOfBound(key, handle);
+        if (found != _candidates.end()) {
+            if (!ahead) {
+                *found = _candidates.back();
+                _candidates.pop_back();
+                if (_candidates.size() < _n) _stale = true;
+            }
+        } else if (ahead) {
+            // Переполнение кандидатов — тоже повод перестроиться с новой границей
+            if (_candidates.size() == _candidates.capacity()) _stale = true;
+            else _candidates.push_back(handle);
+        }
+    }
+
+    // Первые n (n ≤ отслеживаемого) по убыванию ключа
+    void Top(const std::vector<std::int32_t>& keys, std::size_t n, std::vector<std::uint32_t>& out) {
+        if (_stale) Rebuild(keys);
+        out.assign(_candidates.begin(), _candidates.end());
+        auto before = [&keys](std::uint32_t a, std::uint32_t b) { return Ahead(keys[a], a, keys[b], b); };
+        n = std::min(n, out.size());
+        std::partial_sort(out.begin(), out.begin() + static_cast<std::ptrdiff_t>(n), out.end(), before);
+        out.resize(n);
+    }
+};
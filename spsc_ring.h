@@ -0,0 +1,89 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+// === Кольцевой буфер: один писатель, один читатель, без блокировок ===
+// Ёмкость — степень двойки. Индексы писателя и читателя лежат в разных
+// кеш-линиях; каждая сторона держит копию индекса другой стороны и
+// перечитывает его только когда по копии места (или данных) не хватает.
+// Push и Pop работают пачками: одна публикация индекса на пачку
+template <typename T>
+class SpscRing {
+private:
+    std::unique_ptr<T[]> _items;
+    std::size_t _mask;
+
+    alignas(64) std::atomic<std::size_t> _head{0};  // пишет читатель
+    std::size_t _cachedTail = 0;
+
+    alignas(64) std::atomic<std::size_t> _tail{0};  // пишет писатель
+    std::size_t _cachedHead = 0;
+
+    alignas(64) std::atomic<std::size_t> _highWater{0};
+
+public:
+    // capacity округляется вверх до степени двойки
+    explicit SpscRing(std::size_t capacity) {
+        std::size_t size = 2;
+        while (size < capacity) size <<= 1;
+        _items.reset(new T[size]);
+        _mask = size - 1;
+    }
+
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    std::size_t Capacity() const { return _mask + 1; }
+
+    // --- Сторона писателя ---
+
+    // Кладёт до count элементов; возвращает, сколько поместилось
+    std::size_t Push(const T* items, std::size_t count) {
+        std::size_t tail = _tail.load(std::memory_order_relaxed);
+        std::size_t free = Capacity() - (tail - _cachedHead);
+        if (free < count) {
+            _cachedHead = _head.load(std::memory_order_acquire);
+            free = Capacity() - (tail - _cachedHead);
+        }
+        if (count > free) count = free;
+        for (std::size_t i = 0; i < count; ++i) _items[(tail + i) & _mask] = items[i];
+        _tail.store(tail + count, std::memory_order_release);
+        std::size_t depth = tail + count - _cachedHead;
+        if (depth > _highWater.load(std::memory_order_relaxed)) _highWater.store(depth, std::memory_order_relaxed);
+        return count;
+    }
+
+    bool Push(const T& item) { return Push(&item, 1) == 1; }
+
+    // --- Сторона читателя ---
+
+    // Забирает до max элементов в out; возвращает, сколько забрано
+    std::size_t Pop(T* out, std::size_t max) {
+        std::size_t head = _head.load(std::memory_order_relaxed);
+        std::size_t available = _cachedTail - head;
+        if (available < max) {
+            _cachedTail = _tail.load(std::memory_order_acquire);
+            available = _cachedTail - head;
+        }
+        if (max > available) max = available;
+        for (std::size_t i = 0; i < max; ++i) out[i] = _items[(head + i) & _mask];
+        _head.store(head + max, std::memory_order_release);
+        return max;
+    }
+
+    bool Pop(T& item) { return Pop(&item, 1) == 1; }
+
+    // --- Из любого потока (приблизительно) ---
+
+    // Голова читается первой: хвост, прочитанный позже, не меньше неё
+    std::size_t Depth() const {
+        std::size_t head = _head.load(std::memory_order_relaxed);
+        return _tail.load(std::memory_order_relaxed) - head;
+    }
+
+    // Наибольшая глубина, которую видел писатель
+    std::size_t HighWater() const { return _highWater.load(std::memory_order_relaxed); }
+};
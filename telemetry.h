@@ -0,0 +1,325 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstring>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#include "device_manager.h"
+#include "sharded_counter.h"
+#include "spsc_ring.h"
+
+// === Приём телеметрии мощности ===
+// Устройства присылают датаграммы (UDP на 127.0.0.1 или Unix datagram) из
+// записей по 8 байт: дескриптор (uint32) и мощность в ваттах (int32), оба
+// little-endian. Поток приёма забирает датаграммы пачками через recvmmsg,
+// разбирает записи и передаёт их через SpscRing; применяет их поток-
+// владелец DeviceManager: либо сам вызывает Drain, либо отдаёт менеджер
+// потоку применения (StartApplier). DeviceManager::SetMeasuredPower
+// обновляет итоги на разницу с прошлым показанием, без пересчёта.
+// Если кольцо заполнено, приём ждёт: излишек копится в буфере сокета, а
+// при его переполнении теряется ядром (для UDP) или тормозит отправителя
+// (для Unix-сокета). На Windows не поддерживается
+
+struct PowerReading {
+    std::uint32_t handle;
+    std::int32_t watts;
+};
+
+namespace telemetry_wire {
+
+constexpr std::size_t kRecordBytes = 8;
+// Записей в одной датаграмме: 1440 байт помещаются в кадр Ethernet
+constexpr std::size_t kMaxRecords = 180;
+constexpr std::size_t kMaxDatagramBytes = kRecordBytes * kMaxRecords;
+
+inline void Encode(const PowerReading& reading, unsigned char* out) {
+    for (int i = 0; i < 4; ++i) out[i] = static_cast<unsigned char>(reading.handle >> (8 * i));
+    std::uint32_t watts = static_cast<std::uint32_t>(reading.watts);
+    for (int i = 0; i < 4; ++i) out[4 + i] = static_cast<unsigned char>(watts >> (8 * i));
+}
+
+inline PowerReading Decode(const unsigned char* in) {
+    std::uint32_t handle = 0, watts = 0;
+    for (int i = 0; i < 4; ++i) handle |= static_cast<std::uint32_t>(in[i]) << (8 * i);
+    for (int i = 0; i < 4; ++i) watts |= static_cast<std::uint32_t>(in[4 + i]) << (8 * i);
+    return {handle, static_cast<std::int32_t>(watts)};
+}
+
+}  // namespace telemetry_wire
+
+// --- Получатель разобранных показаний (например, TelemetryPipeline) ---
+// Вызывается потоком приёма: Submit — на показания пачки recvmmsg, уже
+// разобранные для кольца применения (повторно их никто не разбирает),
+// Flush — следом за ним
+class IReadingSink {
+public:
+    virtual void Submit(const PowerReading* readings, std::size_t count) = 0;
+    virtual void Flush() = 0;
+    virtual ~IReadingSink() = default;
+};
+
+class TelemetryIngest {
+private:
+    // Датаграмм за один recvmmsg и записей, применяемых за один Drain
+    static constexpr std::size_t kBatchDatagrams = 64;
+    static constexpr std::size_t kApplyBatch = 4096;
+
+    SpscRing<PowerReading> _ring;
+    std::vector<unsigned char> _datagrams;  // буферы приёма, принадлежат потоку приёма
+    std::vector<PowerReading> _applyBuffer;
+    std::function<void()> _batchHook;
+    IReadingSink* _sink = nullptr;
+    std::atomic<bool> _stop{false};
+    std::atomic<long long> _totalPower{0};
+    int _fd = -1;
+    int _wakeFd = -1;
+    std::uint16_t _port = 0;
+    std::string _unixPath;
+    std::thread _receiver;
+    std::thread _applier;
+
+#ifndef _WIN32
+    bool Fail(const char* what, std::string& error) {
+        error = what;
+        error += ": ";
+        error += std::strerror(errno);
+        Close();
+        return false;
+    }
+
+    void Close() {
+        if (_fd >= 0) ::close(_fd);
+        if (_wakeFd >= 0) ::close(_wakeFd);
+        _fd = _wakeFd = -1;
+        if (!_unixPath.empty()) ::unlink(_unixPath.c_str());
+        _unixPath.clear();
+    }
+
+    bool Prepare(int fd, std::string& error) {
+        _fd = fd;
+        if (_fd < 0) return Fail("socket", error);
+        // Запас на всплески, пока поток приёма отстаёт
+        int bufferBytes = 8 << 20;
+        ::setsockopt(_fd, SOL_SOCKET, SO_RCVBUF, &bufferBytes, sizeof(bufferBytes));
+        _wakeFd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (_wakeFd < 0) return Fail("eventfd", error);
+        return true;
+    }
+
+    // Кладёт всё в кольцо, дожидаясь места; false — пора останавливаться
+    bool Hand(const PowerReading* readings, std::size_t count) {
+        while (count > 0) {
+            std::size_t pushed = _ring.Push(readings, count);
+            readings += pushed;
+            count -= pushed;
+            if (count == 0) break;
+            if (_stop.load(std::memory_order_relaxed)) return false;
+            std::this_thread::yield();
+        }
+        return true;
+    }
+
+    void Receive() {
+        mmsghdr messages[kBatchDatagrams];
+        iovec vectors[kBatchDatagrams];
+        for (std::size_t i = 0; i < kBatchDatagrams; ++i) {
+            vectors[i] = {&_datagrams[i * telemetry_wire::kMaxDatagramBytes], telemetry_wire::kMaxDatagramBytes};
+            messages[i] = {};
+            messages[i].msg_hdr.msg_iov = &vectors[i];
+            messages[i].msg_hdr.msg_iovlen = 1;
+        }
+        std::vector<PowerReading> parsed(kBatchDatagrams * telemetry_wire::kMaxRecords);
+        OperationalStats& stats = OperationalStats::Get();
+
+        while (!_stop.load(std::memory_order_relaxed)) {
+            int received = ::recvmmsg(_fd, messages, kBatchDatagrams, MSG_DONTWAIT, nullptr);
+            if (received < 0) {
+                if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) return;
+                pollfd fds[2] = {{_fd, POLLIN, 0}, {_wakeFd, POLLIN, 0}};
+                ::poll(fds, 2, -1);
+                continue;
+            }
+            std::size_t count = 0, rejected = 0;
+            for (int m = 0; m < received; ++m) {
+                std::size_t bytes = messages[m].msg_len;
+                const unsigned char* data = &_datagrams[m * telemetry_wire::kMaxDatagramBytes];
+                // Хвост, не кратный записи, или обрезанная датаграмма — повреждение:
+                // отбрасываем её целиком
+                if (bytes % telemetry_wire::kRecordBytes != 0 || (messages[m].msg_hdr.msg_flags & MSG_TRUNC)) {
+                    rejected += bytes / telemetry_wire::kRecordBytes + 1;
+                    continue;
+                }
+                for (std::size_t offset = 0; offset < bytes; offset += telemetry_wire::kRecordBytes) {
+                    parsed[count++] = telemetry_wire::Decode(data + offset);
+                }
+            }
+            if (_sink && count > 0) {
+                _sink->Submit(parsed.data(), count);
+                _sink->Flush();
+            }
+            stats.readingsReceived.Add(static_cast<std::int64_t>(count));
+            if (rejected) stats.readingsRejected.Add(static_cast<std::int64_t>(rejected));
+            if (!Hand(parsed.data(), count)) return;
+        }
+    }
+
+    void Apply(DeviceManager& manager) {
+        unsigned idle = 0;
+        while (!_stop.load(std::memory_order_relaxed)) {
+            if (Drain(manager) > 0) {
+                idle = 0;
+                continue;
+            }
+            // Сначала уступаем процессор, при долгой тишине — спим
+            if (++idle < 64) std::this_thread::yield();
+            else std::this_thread::sleep_for(std::chrono::microseconds(200));
+        }
+        while (Drain(manager) > 0) {
+        }
+    }
+#endif
+
+public:
+    explicit TelemetryIngest(std::size_t ringCapacity = 1 << 16)
+        : _ring(ringCapacity), _datagrams(kBatchDatagrams * telemetry_wire::kMaxDatagramBytes), _applyBuffer(kApplyBatch) {}
+
+    ~TelemetryIngest() { Stop(); }
+
+    TelemetryIngest(const TelemetryIngest&) = delete;
+    TelemetryIngest& operator=(const TelemetryIngest&) = delete;
+
+    // Вызывается потоком применения после каждой непустой пачки, например
+    // для публикации метрик. Задаётся до StartApplier
+    void SetBatchHook(std::function<void()> hook) { _batchHook = std::move(hook); }
+
+    // Разобранные показания уходят ещё и в sink; задаётся до StartReceiver,
+    // sink должен работать до Stop
+    void SetSink(IReadingSink* sink) { _sink = sink; }
+
+    // Слушать UDP на 127.0.0.1:port (0 — любой свободный порт)
+    bool OpenUdp(std::uint16_t port, std::string& error) {
+#ifdef _WIN32
+        (void)port;
+        error = "telemetry ingestion is not supported on Windows";
+        return false;
+#else
+        if (!Prepare(::socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0), error)) return false;
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(port);
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (::bind(_fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) return Fail("bind", error);
+        socklen_t length = sizeof(address);
+        ::getsockname(_fd, reinterpret_cast<sockaddr*>(&address), &length);
+        _port = ntohs(address.sin_port);
+        return true;
+#endif
+    }
+
+    // Слушать Unix datagram-сокет path; существующий файл заменяется
+    bool OpenUnix(const std::string& path, std::string& error) {
+#ifdef _WIN32
+        (void)path;
+        error = "telemetry ingestion is not supported on Windows";
+        return false;
+#else
+        sockaddr_un address{};
+        if (path.size() >= sizeof(address.sun_path)) {
+            error = "socket path is too long";
+            return false;
+        }
+        if (!Prepare(::socket(AF_UNIX, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0), error)) return false;
+        address.sun_family = AF_UNIX;
+        std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+        ::unlink(path.c_str());
+        if (::bind(_fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) return Fail("bind", error);
+        _unixPath = path;
+        return true;
+#endif
+    }
+
+    bool StartReceiver(std::string& error) {
+#ifdef _WIN32
+        error = "telemetry ingestion is not supported on Windows";
+        return false;
+#else
+        if (_fd < 0) {
+            error = "telemetry socket is not open";
+            return false;
+        }
+        if (_receiver.joinable()) {
+            error = "telemetry receiver is already running";
+            return false;
+        }
+        _stop = false;
+        _receiver = std::thread([this] { Receive(); });
+        return true;
+#endif
+    }
+
+    // Отдаёт менеджер потоку применения до Stop
+    void StartApplier(DeviceManager& manager) {
+#ifndef _WIN32
+        if (_applier.joinable()) return;
+        _applier = std::thread([this, &manager] { Apply(manager); });
+#else
+        (void)manager;
+#endif
+    }
+
+    // Применяет до kApplyBatch показаний из кольца; вызывает только
+    // поток-владелец менеджера. Возвращает число забранных показаний
+    std::size_t Drain(DeviceManager& manager) {
+        std::size_t count = _ring.Pop(_applyBuffer.data(), _applyBuffer.size());
+        if (count == 0) return 0;
+        std::size_t applied = 0;
+        for (std::size_t i = 0; i < count; ++i) {
+            applied += manager.SetMeasuredPower(_applyBuffer[i].handle, _applyBuffer[i].watts) ? 1 : 0;
+        }
+        OperationalStats& stats = OperationalStats::Get();
+        stats.readingsApplied.Add(static_cast<std::int64_t>(applied));
+        if (applied < count) stats.readingsRejected.Add(static_cast<std::int64_t>(count - applied));
+        _totalPower.store(manager.GetTotalPower(), std::memory_order_relaxed);
+        if (_batchHook) _batchHook();
+        return count;
+    }
+
+    void Stop() {
+#ifndef _WIN32
+        _stop = true;
+        if (_wakeFd >= 0) {
+            std::uint64_t one = 1;
+            ssize_t written = ::write(_wakeFd, &one, sizeof(one));
+            (void)written;
+        }
+        if (_receiver.joinable()) _receiver.join();
+        if (_applier.joinable()) _applier.join();
+        Close();
+#endif
+    }
+
+    std::uint16_t Port() const { return _port; }
+
+    // Для наблюдения из любого потока
+    std::size_t QueueDepth() const { return _ring.Depth(); }
+    std::size_t QueueHighWater() const { return _ring.HighWater(); }
+    // Суммарная мощность после последней применённой пачки
+    long long LastTotalPower() const { return _totalPower.load(std::memory_order_relaxed); }
+};
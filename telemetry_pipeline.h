@@ -0,0 +1,494 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include "device_manager.h"
+#include "spsc_ring.h"
+#include "telemetry.h"
+
+// === Конвейер обработки телеметрии: разбор → окно → оповещения ===
+// Стадии получают пачки от предыдущей через PipelineLink:
+//  - Parse  — работает в потоке приёма: датаграммы там уже разобраны для
+//             кольца применения (TelemetryIngest), и Submit только
+//             отсеивает чужие дескрипторы и складывает показания в пачки;
+//  - Window — копит показания в окне фиксированной длины и на его
+//             закрытии выдаёт по каждому устройству число показаний,
+//             среднее и максимум, а по группе — сумму средних устройств;
+//  - Alert  — сверяет итоги окна с порогами (перегрузка устройства
+//             относительно паспортной мощности, лимит группы) и вызывает
+//             обработчик оповещений.
+// Window и Alert работают в своих потоках; если процессу разрешено больше
+// ядер, чем нужно стадиям, потокам приёма и применения, стадии
+// закрепляются за последними разрешёнными ядрами (sched_getaffinity),
+// а первые остаются планировщику для потоков приёма и применения.
+// Пачки не выделяются на ходу: у каждого звена свой пул, и пустые пачки
+// возвращаются писателю обратным кольцом. Когда пул исчерпан, писатель
+// ждёт — так медленная стадия тормозит предыдущие вплоть до Submit.
+// По каждой стадии считаются пачки, элементы на входе и выходе, время
+// работы и ожидания свободной пачки; глубина входной очереди и доля
+// занятого времени показывают узкое место
+
+// --- Звено между стадиями: очередь полных пачек и пул пустых ---
+template <typename Batch>
+class PipelineLink {
+private:
+    std::vector<std::unique_ptr<Batch>> _storage;
+    SpscRing<Batch*> _full;
+    SpscRing<Batch*> _free;
+
+public:
+    explicit PipelineLink(std::size_t batches) : _full(batches), _free(batches) {
+        for (std::size_t i = 0; i < batches; ++i) {
+            _storage.push_back(std::make_unique<Batch>());
+            _free.Push(_storage.back().get());
+        }
+    }
+
+    // Писатель: пустая пачка или nullptr, если все заняты
+    Batch* TryAcquire() {
+        Batch* batch = nullptr;
+        return _free.Pop(batch) ? batch : nullptr;
+    }
+
+    void Send(Batch* batch) { _full.Push(batch); }
+
+    // Читатель: полная пачка или nullptr
+    Batch* Receive() {
+        Batch* batch = nullptr;
+        return _full.Pop(batch) ? batch : nullptr;
+    }
+
+    void Release(Batch* batch) {
+        batch->Clear();
+        _free.Push(batch);
+    }
+
+    std::size_t Depth() const { return _full.Depth(); }
+    std::size_t Capacity() const { return _storage.size(); }
+};
+
+struct PipelineAlert {
+    enum class Kind : std::uint8_t { DeviceOverload, GroupLimit };
+
+    Kind kind;
+    std::uint64_t window;  // номер окна с запуска конвейера
+    std::uint32_t id;      // дескриптор устройства или номер группы
+    double value;          // ватты: максимум устройства или сумма средних группы
+    double limit;
+};
+
+class TelemetryPipeline : public IReadingSink {
+public:
+    enum class Stage : std::uint8_t { Parse, Window, Alert, Count };
+
+    static const char* StageName(Stage stage) {
+        switch (stage) {
+            case Stage::Parse: return "parse";
+            case Stage::Window: return "window";
+            case Stage::Alert: return "alert";
+            case Stage::Count: break;
+        }
+        return "?";
+    }
+
+    // Снимок счётчиков стадии; читается из любого потока
+    struct StageStats {
+        std::uint64_t batches = 0;
+        std::uint64_t itemsIn = 0;
+        std::uint64_t itemsOut = 0;
+        double busySeconds = 0;
+        double stallSeconds = 0;  // ожидание свободной пачки на выходе
+        std::size_t queueDepth = 0;
+        std::size_t queueCapacity = 0;
+    };
+
+    // Устройства и пороги; снимается с DeviceManager в его потоке до Start
+    struct Config {
+        std::vector<std::uint16_t> groupOf;
+        std::vector<std::int32_t> ratedPower;
+        std::vector<std::string> groupNames;
+        std::vector<double> groupLimits;  // 0 — без лимита
+        double overloadRatio = 1.5;       // максимум сверх паспортной мощности, после которого — оповещение
+        std::chrono::milliseconds window{1000};
+
+        static Config FromManager(const DeviceManager& manager) {
+            Config config;
+            config.groupOf = manager.GetGroupColumn();
+            config.ratedPower = manager.GetRatedPowerColumn();
+            for (const DeviceGroupStats& group : manager.GetGroups()) config.groupNames.push_back(group.name);
+            config.groupLimits.assign(config.groupNames.size(), 0.0);
+            return config;
+        }
+    };
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr std::size_t kReadingBatch = 4096;
+    static constexpr std::size_t kSampleBatch = 1024;
+    static constexpr std::size_t kBatchesPerLink = 8;
+
+    struct ReadingBatch {
+        std::size_t count = 0;
+        PowerReading readings[kReadingBatch];
+        void Clear() { count = 0; }
+    };
+
+    // Итог окна по устройству (group == false) или по группе
+    struct WindowSample {
+        std::uint64_t window;
+        std::uint32_t id;
+        bool group;
+        std::uint32_t readings;
+        double mean;
+        std::int32_t max;
+    };
+
+    struct SampleBatch {
+        std::size_t count = 0;
+        WindowSample samples[kSampleBatch];
+        void Clear() { count = 0; }
+    };
+
+    // Пишет только поток стадии (для Parse — производитель, вызывающий Submit)
+    struct alignas(64) StageCounters {
+        std::atomic<std::uint64_t> batches{0};
+        std::atomic<std::uint64_t> itemsIn{0};
+        std::atomic<std::uint64_t> itemsOut{0};
+        std::atomic<std::uint64_t> busyNs{0};
+        std::atomic<std::uint64_t> stallNs{0};
+
+        static void Bump(std::atomic<std::uint64_t>& cell, std::uint64_t delta) {
+            cell.store(cell.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+        }
+    };
+
+    Config _config;
+    std::function<void(const PipelineAlert&)> _onAlert;
+    PipelineLink<ReadingBatch> _readings{kBatchesPerLink};
+    PipelineLink<SampleBatch> _samples{kBatchesPerLink};
+    StageCounters _counters[static_cast<std::size_t>(Stage::Count)];
+    std::atomic<std::uint64_t> _alerts{0};
+    // Стадии останавливаются по порядку: каждая дочитывает вход и выходит
+    std::atomic<bool> _stopping[static_cast<std::size_t>(Stage::Count)] = {};
+    std::vector<std::thread> _threads;  // Window, Alert
+
+    // Незаполненная пачка производителя (Submit)
+    ReadingBatch* _pending = nullptr;
+
+    // Состояние окна — принадлежит потоку Window
+    std::uint64_t _window = 0;
+    Clock::time_point _windowEnd;
+    std::vector<std::uint32_t> _deviceReadings;
+    std::vector<std::int64_t> _deviceSum;
+    std::vector<std::int32_t> _deviceMax;
+    std::vector<std::uint32_t> _touched;
+    std::vector<double> _groupDemand;
+    std::vector<std::uint32_t> _groupReadings;
+    std::vector<std::int32_t> _groupMax;
+
+    StageCounters& CountersOf(Stage stage) { return _counters[static_cast<std::size_t>(stage)]; }
+
+    static std::uint64_t NanosecondsSince(Clock::time_point start) {
+        return static_cast<std::uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count());
+    }
+
+    // Ждёт свободную пачку звена; время ожидания прибавляется к stallNs.
+    // Читатель звена работает, пока не остановлен писатель, поэтому пачка
+    // рано или поздно освободится
+    template <typename Batch>
+    static Batch* Acquire(PipelineLink<Batch>& link, std::atomic<std::uint64_t>& stallNs) {
+        Batch* batch = link.TryAcquire();
+        if (batch) return batch;
+        auto start = Clock::now();
+        while (!(batch = link.TryAcquire())) std::this_thread::yield();
+        StageCounters::Bump(stallNs, NanosecondsSince(start));
+        return batch;
+    }
+
+    bool Stopping(Stage stage) const {
+        return _stopping[static_cast<std::size_t>(stage)].load(std::memory_order_acquire);
+    }
+
+    // Следующая пачка входа стадии; nullptr — стадия остановлена и вход пуст
+    template <typename Batch>
+    Batch* Next(PipelineLink<Batch>& link, Stage stage, unsigned& idle) {
+        for (;;) {
+            if (Batch* batch = link.Receive()) {
+                idle = 0;
+                return batch;
+            }
+            // Флаг проверяется до повторной попытки: всё отправленное до него будет прочитано
+            if (Stopping(stage)) return link.Receive();
+            if (stage == Stage::Window && Clock::now() >= _windowEnd) return nullptr;
+            Idle(idle);
+        }
+    }
+
+    static void Idle(unsigned& idle) {
+        if (++idle < 64) std::this_thread::yield();
+        else std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+
+    // Ядра, на которых процессу разрешено работать, по возрастанию
+    static std::vector<unsigned> AllowedCores() {
+        std::vector<unsigned> cores;
+#if defined(__linux__)
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        if (sched_getaffinity(0, sizeof(set), &set) != 0) return cores;
+        for (unsigned core = 0; core < CPU_SETSIZE; ++core) {
+            if (CPU_ISSET(core, &set)) cores.push_back(core);
+        }
+#endif
+        return cores;
+    }
+
+    static void PinToCore(std::thread& thread, unsigned core) {
+#if defined(__linux__)
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(core, &set);
+        pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set);
+#else
+        (void)thread;
+        (void)core;
+#endif
+    }
+
+    // --- Стадия Window ---
+    void EmitSample(SampleBatch*& out, const WindowSample& sample) {
+        if (!out) out = Acquire(_samples, CountersOf(Stage::Window).stallNs);
+        out->samples[out->count++] = sample;
+        if (out->count == kSampleBatch) {
+            _samples.Send(out);
+            out = nullptr;
+        }
+    }
+
+    // Закрывает окно: итоги тронутых устройств и всех групп с показаниями
+    std::uint64_t CloseWindow() {
+        SampleBatch* out = nullptr;
+        std::uint64_t emitted = 0;
+        for (std::uint32_t handle : _touched) {
+            std::uint32_t readings = _deviceReadings[handle];
+            double mean = static_cast<double>(_deviceSum[handle]) / readings;
+            EmitSample(out, {_window, handle, false, readings, mean, _deviceMax[handle]});
+            std::uint16_t group = _config.groupOf[handle];
+            _groupDemand[group] += mean;
+            _groupReadings[group] += readings;
+            _groupMax[group] = std::max(_groupMax[group], _deviceMax[handle]);
+            _deviceReadings[handle] = 0;
+            _deviceSum[handle] = 0;
+            _deviceMax[handle] = 0;
+            ++emitted;
+        }
+        _touched.clear();
+        for (std::uint32_t group = 0; group < _groupDemand.size(); ++group) {
+            if (_groupReadings[group] == 0) continue;
+            EmitSample(out, {_window, group, true, _groupReadings[group], _groupDemand[group], _groupMax[group]});
+            _groupDemand[group] = 0;
+            _groupReadings[group] = 0;
+            _groupMax[group] = 0;
+            ++emitted;
+        }
+        if (out) _samples.Send(out);
+        ++_window;
+        _windowEnd += _config.window;
+        return emitted;
+    }
+
+    void RunWindow() {
+        StageCounters& counters = CountersOf(Stage::Window);
+        _windowEnd = Clock::now() + _config.window;
+        unsigned idle = 0;
+        auto close = [&] {
+            auto start = Clock::now();
+            StageCounters::Bump(counters.itemsOut, CloseWindow());
+            StageCounters::Bump(counters.busyNs, NanosecondsSince(start));
+        };
+        for (;;) {
+            // Окно закрывается по времени, даже если показаний нет
+            if (Clock::now() >= _windowEnd) close();
+            ReadingBatch* batch = Next(_readings, Stage::Window, idle);
+            if (!batch) {
+                if (!Stopping(Stage::Window)) continue;
+                // Неполное последнее окно тоже уходит дальше
+                close();
+                break;
+            }
+            auto start = Clock::now();
+            for (std::size_t i = 0; i < batch->count; ++i) {
+                const PowerReading& reading = batch->readings[i];
+                std::uint32_t handle = reading.handle;
+                if (_deviceReadings[handle]++ == 0) {
+                    _touched.push_back(handle);
+                    _deviceMax[handle] = reading.watts;
+                }
+                _deviceSum[handle] += reading.watts;
+                _deviceMax[handle] = std::max(_deviceMax[handle], reading.watts);
+            }
+            StageCounters::Bump(counters.batches, 1);
+            StageCounters::Bump(counters.itemsIn, batch->count);
+            _readings.Release(batch);
+            StageCounters::Bump(counters.busyNs, NanosecondsSince(start));
+        }
+    }
+
+    // --- Стадия Alert ---
+    void RunAlert() {
+        StageCounters& counters = CountersOf(Stage::Alert);
+        unsigned idle = 0;
+        while (SampleBatch* batch = Next(_samples, Stage::Alert, idle)) {
+            auto start = Clock::now();
+            std::uint64_t raised = 0;
+            for (std::size_t i = 0; i < batch->count; ++i) {
+                const WindowSample& sample = batch->samples[i];
+                PipelineAlert alert;
+                if (sample.group) {
+                    double limit = _config.groupLimits[sample.id];
+                    if (limit <= 0 || sample.mean <= limit) continue;
+                    alert = {PipelineAlert::Kind::GroupLimit, sample.window, sample.id, sample.mean, limit};
+                } else {
+                    double limit = _config.ratedPower[sample.id] * _config.overloadRatio;
+                    if (sample.max <= limit) continue;
+                    alert = {PipelineAlert::Kind::DeviceOverload, sample.window, sample.id,
+                             static_cast<double>(sample.max), limit};
+                }
+                ++raised;
+                if (_onAlert) _onAlert(alert);
+            }
+            StageCounters::Bump(counters.batches, 1);
+            StageCounters::Bump(counters.itemsIn, batch->count);
+            StageCounters::Bump(counters.itemsOut, raised);
+            _alerts.fetch_add(raised, std::memory_order_relaxed);
+            _samples.Release(batch);
+            StageCounters::Bump(counters.busyNs, NanosecondsSince(start));
+        }
+    }
+
+public:
+    // onAlert вызывается потоком стадии Alert
+    explicit TelemetryPipeline(Config config, std::function<void(const PipelineAlert&)> onAlert = nullptr)
+        : _config(std::move(config)), _onAlert(std::move(onAlert)) {
+        std::size_t devices = _config.groupOf.size();
+        _deviceReadings.assign(devices, 0);
+        _deviceSum.assign(devices, 0);
+        _deviceMax.assign(devices, 0);
+        _touched.reserve(devices);
+        _groupDemand.assign(_config.groupNames.size(), 0.0);
+        _groupReadings.assign(_config.groupNames.size(), 0);
+        _groupMax.assign(_config.groupNames.size(), 0);
+        _config.groupLimits.resize(_config.groupNames.size(), 0.0);
+    }
+
+    ~TelemetryPipeline() { Stop(); }
+
+    TelemetryPipeline(const TelemetryPipeline&) = delete;
+    TelemetryPipeline& operator=(const TelemetryPipeline&) = delete;
+
+    const Config& GetConfig() const { return _config; }
+
+    // Стадии запускаются один раз; после Stop конвейер не перезапускается
+    void Start() {
+        if (!_threads.empty()) return;
+        _threads.emplace_back([this] { RunWindow(); });
+        _threads.emplace_back([this] { RunAlert(); });
+        // Два ядра сверх стадий — потокам приёма и применения
+        std::vector<unsigned> cores = AllowedCores();
+        if (cores.size() < _threads.size() + 2) return;
+        for (std::size_t i = 0; i < _threads.size(); ++i) {
+            PinToCore(_threads[i], cores[cores.size() - _threads.size() + i]);
+        }
+    }
+
+    // Останавливает стадии по очереди, дочитав уже переданные пачки.
+    // Производитель к этому моменту должен перестать вызывать Submit
+    void Stop() {
+        if (_threads.empty()) return;
+        Flush();
+        if (_pending) {
+            _readings.Release(_pending);
+            _pending = nullptr;
+        }
+        const Stage order[] = {Stage::Window, Stage::Alert};
+        for (std::size_t i = 0; i < _threads.size(); ++i) {
+            _stopping[static_cast<std::size_t>(order[i])].store(true, std::memory_order_release);
+            _threads[i].join();
+        }
+        _threads.clear();
+    }
+
+    // --- Сторона производителя (стадия Parse): вызывать из одного потока ---
+
+    // Разобранные показания; чужие дескрипторы отсеиваются, остальные
+    // копятся в текущую пачку. Ждёт, если стадия Window не успевает
+    // (все пачки звена заняты)
+    void Submit(const PowerReading* readings, std::size_t count) override {
+        if (_threads.empty()) return;
+        StageCounters& counters = CountersOf(Stage::Parse);
+        auto start = Clock::now();
+        std::size_t devices = _config.groupOf.size(), produced = 0;
+        for (std::size_t i = 0; i < count; ++i) {
+            if (readings[i].handle >= devices) continue;
+            if (!_pending) _pending = Acquire(_readings, counters.stallNs);
+            _pending->readings[_pending->count++] = readings[i];
+            ++produced;
+            if (_pending->count == kReadingBatch) Flush();
+        }
+        StageCounters::Bump(counters.itemsIn, count);
+        StageCounters::Bump(counters.itemsOut, produced);
+        StageCounters::Bump(counters.busyNs, NanosecondsSince(start));
+    }
+
+    // Отдаёт накопленное стадии Window
+    void Flush() override {
+        if (!_pending || _pending->count == 0) return;
+        _readings.Send(_pending);
+        _pending = nullptr;
+        StageCounters::Bump(CountersOf(Stage::Parse).batches, 1);
+    }
+
+    // Ожидание производителя на входе конвейера, секунды
+    double SubmitStallSeconds() const {
+        return _counters[static_cast<std::size_t>(Stage::Parse)].stallNs.load(std::memory_order_relaxed) / 1e9;
+    }
+
+    // --- Наблюдение: из любого потока ---
+
+    StageStats Stats(Stage stage) const {
+        const StageCounters& counters = _counters[static_cast<std::size_t>(stage)];
+        StageStats stats;
+        stats.batches = counters.batches.load(std::memory_order_relaxed);
+        stats.itemsIn = counters.itemsIn.load(std::memory_order_relaxed);
+        stats.itemsOut = counters.itemsOut.load(std::memory_order_relaxed);
+        stats.busySeconds = counters.busyNs.load(std::memory_order_relaxed) / 1e9;
+        stats.stallSeconds = counters.stallNs.load(std::memory_order_relaxed) / 1e9;
+        // Вход Parse — сам вызов Submit, очереди перед ним нет
+        switch (stage) {
+            case Stage::Parse: break;
+            case Stage::Window: stats.queueDepth = _readings.Depth(); stats.queueCapacity = _readings.Capacity(); break;
+            case Stage::Alert: stats.queueDepth = _samples.Depth(); stats.queueCapacity = _samples.Capacity(); break;
+            case Stage::Count: break;
+        }
+        return stats;
+    }
+
+    std::uint64_t AlertCount() const { return _alerts.load(std::memory_order_relaxed); }
+};
@@ -0,0 +1,182 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "profiler.h"
+
+// === Трассировка операций в формате Chrome trace_event ===
+// Включается определением ELECTRIC_DEVICES_TRACING (опция CMake
+// ELECTRIC_DEVICES_TRACING); без него TRACE_SPAN и TRACE_SPAN_ARG
+// разворачиваются в пустые операции.
+//
+// Отрезок записывается одним событием "X" (начало и длительность) при
+// выходе из области: два чтения счётчика тактов и запись 40 байт в буфер
+// своего потока, без блокировок и атомарных read-modify-write. Буфер
+// фиксированного размера; при переполнении события отбрасываются и
+// считаются. Tracer::WriteChromeJson выгружает все буферы для
+// chrome://tracing или Perfetto
+
+class Tracer {
+public:
+#ifdef ELECTRIC_DEVICES_TRACING
+    static constexpr bool kEnabled = true;
+#else
+    static constexpr bool kEnabled = false;
+#endif
+
+    static constexpr std::size_t kEventsPerThread = 1 << 16;
+
+    struct Event {
+        const char* name;
+        const char* argName;  // nullptr — без аргумента
+        std::uint64_t begin;
+        std::uint64_t end;
+        long long argValue;
+    };
+
+private:
+    // Буфер одного потока: пишет только владелец, а число записанных
+    // событий публикуется release-сохранением, поэтому выгрузка из другого
+    // потока видит только полностью записанные события. Память буфера
+    // обнуляется при регистрации, чтобы отрезки не платили за первые
+    // обращения к страницам
+    struct ThreadBuffer {
+        std::uint64_t tid;    // идентификатор потока ОС
+        std::uint32_t index;  // порядок регистрации: им упорядочены дорожки
+        std::atomic<std::size_t> size{0};
+        std::atomic<std::uint64_t> dropped{0};
+        std::unique_ptr<Event[]> events{new Event[kEventsPerThread]()};
+    };
+
+    struct Registry {
+        std::mutex mutex;
+        std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+    };
+
+    // Буферы переживают свои потоки и не освобождаются: выгрузка возможна
+    // в любой момент, в том числе из atexit
+    static Registry& GetRegistry() {
+        static Registry* registry = new Registry();
+        return *registry;
+    }
+
+    // Идентификатор потока, который показывают top -H, perf и отладчик;
+    // вне Linux — хеш std::thread::id
+    static std::uint64_t OsThreadId() {
+#ifdef __linux__
+        return static_cast<std::uint64_t>(::syscall(SYS_gettid));
+#else
+        return static_cast<std::uint64_t>(std::hash<std::thread::id>{}(std::this_thread::get_id()));
+#endif
+    }
+
+    static ThreadBuffer* RegisterThread() {
+        std::uint64_t tid = OsThreadId();
+        Registry& registry = GetRegistry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        registry.buffers.push_back(std::make_unique<ThreadBuffer>());
+        registry.buffers.back()->tid = tid;
+        registry.buffers.back()->index = static_cast<std::uint32_t>(registry.buffers.size());
+        return registry.buffers.back().get();
+    }
+
+    // Указатель инициализируется константой, поэтому обращение к нему не
+    // проходит через обёртку ленивой инициализации thread_local
+    static ThreadBuffer& CurrentBuffer() {
+        static thread_local ThreadBuffer* buffer = nullptr;
+        if (!buffer) buffer = RegisterThread();
+        return *buffer;
+    }
+
+public:
+    static void Record(const char* name, std::uint64_t begin, std::uint64_t end, const char* argName,
+                       long long argValue) {
+        ThreadBuffer& buffer = CurrentBuffer();
+        std::size_t size = buffer.size.load(std::memory_order_relaxed);
+        if (size == kEventsPerThread) {
+            buffer.dropped.store(buffer.dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            return;
+        }
+        buffer.events[size] = Event{name, argName, begin, end, argValue};
+        buffer.size.store(size + 1, std::memory_order_release);
+    }
+
+    // Выгружает события всех потоков; время — в микросекундах от самого раннего события
+    static bool WriteChromeJson(std::FILE* out) {
+        Registry& registry = GetRegistry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        double nsPerTick = 1.0 / CycleClock::TicksPerNanosecond();
+        std::uint64_t epoch = UINT64_MAX;
+        for (const auto& buffer : registry.buffers) {
+            std::size_t size = buffer->size.load(std::memory_order_acquire);
+            for (std::size_t i = 0; i < size; ++i) epoch = std::min(epoch, buffer->events[i].begin);
+        }
+        std::uint64_t dropped = 0;
+        std::fprintf(out, "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [\n");
+        const char* separator = "";
+        for (const auto& buffer : registry.buffers) {
+            unsigned long long tid = buffer->tid;
+            std::fprintf(out, "%s{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %llu, "
+                              "\"args\": {\"name\": \"thread %u (%llu)\"}},\n"
+                              "{\"name\": \"thread_sort_index\", \"ph\": \"M\", \"pid\": 1, \"tid\": %llu, "
+                              "\"args\": {\"sort_index\": %u}}",
+                         separator, tid, buffer->index, tid, tid, buffer->index);
+            separator = ",\n";
+            std::size_t size = buffer->size.load(std::memory_order_acquire);
+            for (std::size_t i = 0; i < size; ++i) {
+                const Event& event = buffer->events[i];
+                double ts = static_cast<double>(event.begin - epoch) * nsPerTick / 1000.0;
+                double dur = static_cast<double>(event.end - event.begin) * nsPerTick / 1000.0;
+                std::fprintf(out, ",\n{\"name\": \"%s\", \"ph\": \"X\", \"pid\": 1, \"tid\": %llu, \"ts\": %.3f, "
+                                  "\"dur\": %.3f",
+                             event.name, tid, ts, dur);
+                if (event.argName) std::fprintf(out, ", \"args\": {\"%s\": %lld}", event.argName, event.argValue);
+                std::fputc('}', out);
+            }
+            dropped += buffer->dropped.load(std::memory_order_relaxed);
+        }
+        std::fprintf(out, "\n], \"otherData\": {\"dropped_events\": %llu}}\n",
+                     static_cast<unsigned long long>(dropped));
+        return std::ferror(out) == 0;
+    }
+};
+
+// --- Отрезок трассировки: от создания до конца области ---
+class TraceSpan {
+private:
+    const char* _name;
+    const char* _argName;
+    long long _argValue;
+    std::uint64_t _begin;
+
+public:
+    explicit TraceSpan(const char* name, const char* argName = nullptr, long long argValue = 0)
+        : _name(name), _argName(argName), _argValue(argValue), _begin(CycleClock::Now()) {}
+    ~TraceSpan() { Tracer::Record(_name, _begin, CycleClock::Now(), _argName, _argValue); }
+
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+};
+
+#ifdef ELECTRIC_DEVICES_TRACING
+#define TRACE_SPAN(spanName) TraceSpan PROFILE_CONCAT(traceSpan_, __LINE__)(spanName)
+#define TRACE_SPAN_ARG(spanName, argName, argValue) \
+    TraceSpan PROFILE_CONCAT(traceSpan_, __LINE__)(spanName, argName, static_cast<long long>(argValue))
+#else
+#define TRACE_SPAN(spanName) ((void)0)
+#define TRACE_SPAN_ARG(spanName, argName, argValue) ((void)0)
+#endif